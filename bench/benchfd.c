@@ -0,0 +1,114 @@
+#define _DEFAULT_SOURCE // wait4
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define READ_BUFFER 65536 // bytes read from the tool's output at a time
+#define MAX_ARGS 16 // most arguments passed on to the tool
+
+double elapsed(struct timespec* start);
+void run(char *tool, char *proc_root, char **args, int nargs);
+
+
+int main(int argc, char *argv[]){
+    ///_|> descry: benchmarks a showFDtables scan of a --proc-root tree, in table and in --stream mode
+    ///_|> argc: argument count
+    ///_|> argv: SHOWFDTABLES PROC_ROOT [extra arguments]
+    ///_|> returning: return 0 after both runs
+
+    if (argc < 3 || argc - 3 > MAX_ARGS - 4) {
+        fprintf(stderr, "usage: benchfd SHOWFDTABLES PROC_ROOT [extra arguments]\n");
+        exit(1);
+    }
+
+    char *table_args[MAX_ARGS] = {"--format=csv"};
+    char *stream_args[MAX_ARGS] = {"--format=csv", "--stream"};
+    for (int i = 3; i < argc; i++) {
+        table_args[i - 2] = argv[i];
+        stream_args[i - 1] = argv[i];
+    }
+    printf("  mode     fds        seconds   fds/sec      peak RSS    first row\n");
+    run(argv[1], argv[2], table_args, argc - 2);
+    run(argv[1], argv[2], stream_args, argc - 1);
+    return 0;
+}
+
+double elapsed(struct timespec* start){
+    //_|> descry: seconds since start on the monotonic clock
+    //_|> start: start time
+    ///_|> returning: returns the seconds
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void run(char *tool, char *proc_root, char **args, int nargs){
+    //_|> descry: runs the tool once as csv, counting rows as they arrive, timing the first one, and reading peak RSS once it exits
+    //_|> tool: showFDtables binary
+    //_|> proc_root: tree to scan
+    //_|> args, nargs: arguments after --proc-root
+    ///_|> returning: returns nothing, exits if the tool cannot be run
+
+    char root_arg[4096 + 16];
+    snprintf(root_arg, sizeof(root_arg), "--proc-root=%s", proc_root);
+    char *argv[MAX_ARGS + 3];
+    argv[0] = tool;
+    argv[1] = root_arg;
+    for (int i = 0; i < nargs; i++) {
+        argv[i + 2] = args[i];
+    }
+    argv[nargs + 2] = NULL;
+
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        fprintf(stderr, "Cannot create pipe\n");
+        exit(1);
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t child = fork();
+    if (child == -1) {
+        fprintf(stderr, "Cannot fork\n");
+        exit(1);
+    }
+    if (child == 0) {
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        execv(tool, argv);
+        _exit(127);
+    }
+    close(pipe_fds[1]);
+
+    // the first line is the csv header, every line after it is one fd
+    char buf[READ_BUFFER];
+    long lines = 0;
+    double first_row = -1;
+    ssize_t got;
+    while ((got = read(pipe_fds[0], buf, sizeof(buf))) > 0) {
+        for (char *pos = buf; (pos = memchr(pos, '\n', buf + got - pos)) != NULL; pos++) {
+            lines++;
+        }
+        if (first_row < 0 && lines >= 2) {first_row = elapsed(&start);}
+    }
+    close(pipe_fds[0]);
+
+    int status;
+    struct rusage usage;
+    wait4(child, &status, 0, &usage);
+    double total = elapsed(&start);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s failed\n", tool);
+        exit(1);
+    }
+    long fds = lines > 0 ? lines - 1 : 0;
+    printf("  %-8s %-10ld %-9.3f %-12.0f %7ld KB  %.3f s\n", nargs > 1 && strcmp(args[1], "--stream") == 0 ? "stream" : "table",
+           fds, total, total > 0 ? fds / total : 0, usage.ru_maxrss, first_row < 0 ? total : first_row);
+}
@@ -0,0 +1,257 @@
+#define _DEFAULT_SOURCE // usleep, mkdtemp, posix_openpt
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <termios.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define CORES 256 // cpuN lines of the synthetic /proc/stat, and boxes drawn
+#define SHORT_RUN 10 // samples of the two runs, their difference is what frames cost without the setup
+#define LONG_RUN 110
+#define TDELAY "10000" // microseconds between samples
+#define TICK_US 2000 // how often the ticker moves the synthetic counters
+#define STAT_LINE 160 // bytes of one cpu line, counters are fixed width so every rewrite has the same length
+#define PATH_BUFFER 4096 // a path under the synthetic root
+#define READ_BUFFER 65536 // bytes read from the pty at a time
+
+void make_tree(const char *root);
+void write_file(const char *path, const char *contents);
+pid_t start_ticker(const char *root);
+void write_stat(int fd, char *text, size_t size, long *busy, long *idle);
+long read_syscw();
+void run(const char *tool, const char *root, int samples, long *bytes, long *writes);
+
+
+int main(int argc, char *argv[]){
+    ///_|> descry: bytes and write syscalls per sample of myMonitoringTool builds drawing 256 cores whose load changes every sample, run on a pty like a terminal would
+    ///_|> argc: argument count
+    ///_|> argv: MONITOR [MONITOR...], myMonitoringTool binaries to compare
+    ///_|> returning: return 0 after every run
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: benchrender MONITOR [MONITOR...]\n");
+        exit(1);
+    }
+    char root[] = "/tmp/benchrender.XXXXXX";
+    if (mkdtemp(root) == NULL) {
+        fprintf(stderr, "Cannot create %s\n", root);
+        exit(1);
+    }
+    make_tree(root);
+    pid_t ticker = start_ticker(root);
+
+    printf("  %d cores, %d samples         bytes/sample writes/sample\n", CORES, LONG_RUN - SHORT_RUN);
+    for (int i = 1; i < argc; i++) {
+        long short_bytes, short_writes, long_bytes, long_writes;
+        run(argv[i], root, SHORT_RUN, &short_bytes, &short_writes);
+        run(argv[i], root, LONG_RUN, &long_bytes, &long_writes);
+        printf("  %-30s %-12.0f %.2f\n", argv[i], (double)(long_bytes - short_bytes) / (LONG_RUN - SHORT_RUN),
+               (double)(long_writes - short_writes) / (LONG_RUN - SHORT_RUN));
+    }
+
+    kill(ticker, SIGKILL);
+    waitpid(ticker, NULL, 0);
+    char command[PATH_BUFFER];
+    snprintf(command, sizeof(command), "rm -rf %s", root);
+    if (system(command) != 0) {
+        fprintf(stderr, "Cannot remove %s\n", root);
+    }
+    return 0;
+}
+
+void make_tree(const char *root){
+    //_|> descry: writes the proc/cpuinfo and sys max frequency myMonitoringTool reads for CORES cores, proc/stat is written by the ticker
+    //_|> root: tree root
+    ///_|> returning: returns nothing, exits if a file cannot be written
+
+    const char *dirs[] = {"proc", "sys", "sys/devices", "sys/devices/system", "sys/devices/system/cpu", "sys/devices/system/cpu/cpu0", "sys/devices/system/cpu/cpu0/cpufreq"};
+    char path[PATH_BUFFER];
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, dirs[i]);
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Cannot create %s\n", path);
+            exit(1);
+        }
+    }
+
+    char *text = (char *)malloc(CORES * 64);
+    if (text == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    size_t len = 0;
+    for (int cpu = 0; cpu < CORES; cpu++) {
+        len += snprintf(text + len, CORES * 64 - len, "processor\t: %d\n\n", cpu);
+    }
+    snprintf(path, sizeof(path), "%s/proc/cpuinfo", root);
+    write_file(path, text);
+    free(text);
+    snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", root);
+    write_file(path, "3000000\n");
+}
+
+void write_file(const char *path, const char *contents){
+    //_|> descry: creates path holding contents
+    //_|> path: file to write
+    //_|> contents: text to write
+    ///_|> returning: returns nothing, exits if it cannot be written
+
+    FILE *fptr = fopen(path, "w");
+    if (fptr == NULL) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        exit(1);
+    }
+    fputs(contents, fptr);
+    fclose(fptr);
+}
+
+pid_t start_ticker(const char *root){
+    //_|> descry: starts a process that rewrites proc/stat every TICK_US with each core busy for a random share of the ticks, so every sample sees new loads
+    //_|> root: tree root
+    ///_|> returning: returns the ticker's pid once proc/stat is written
+
+    static long busy[CORES + 1];
+    static long idle[CORES + 1];
+    size_t size = (size_t)(CORES + 1) * STAT_LINE;
+    char *text = (char *)malloc(size);
+    if (text == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    char path[PATH_BUFFER];
+    snprintf(path, sizeof(path), "%s/proc/stat", root);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        fprintf(stderr, "Cannot write %s\n", path);
+        exit(1);
+    }
+
+    // the parent writes the first one so the file is complete before it returns
+    write_stat(fd, text, size, busy, idle);
+    pid_t child = fork();
+    if (child == -1) {
+        fprintf(stderr, "Cannot fork\n");
+        exit(1);
+    }
+    if (child > 0) {
+        close(fd);
+        free(text);
+        return child;
+    }
+    while (1) {
+        usleep(TICK_US);
+        write_stat(fd, text, size, busy, idle);
+    }
+}
+
+void write_stat(int fd, char *text, size_t size, long *busy, long *idle){
+    //_|> descry: gives every core a random share of 10 more ticks and rewrites proc/stat in place
+    //_|> fd: proc/stat
+    //_|> text: buffer of size bytes for the file
+    //_|> busy, idle: ticks of each row so far, row 0 is the aggregate line
+    ///_|> returning: returns nothing, exits if the file cannot be written
+
+    busy[0] = idle[0] = 0;
+    for (int cpu = 1; cpu <= CORES; cpu++) {
+        long ticks = rand() % 11;
+        busy[cpu] += ticks;
+        idle[cpu] += 10 - ticks;
+        busy[0] += busy[cpu];
+        idle[0] += idle[cpu];
+    }
+    size_t len = snprintf(text, size, "cpu  %012ld 0 0 %012ld 0 0 0 0 0 0\n", busy[0], idle[0]);
+    for (int cpu = 1; cpu <= CORES; cpu++) {
+        len += snprintf(text + len, size - len, "cpu%-4d %012ld 0 0 %012ld 0 0 0 0 0 0\n", cpu - 1, busy[cpu], idle[cpu]);
+    }
+    if (pwrite(fd, text, len, 0) != (ssize_t)len) {
+        fprintf(stderr, "Cannot write proc/stat\n");
+        exit(1);
+    }
+}
+
+long read_syscw(){
+    //_|> descry: write syscalls of this process and of the children it has waited for, from /proc/self/io
+    ///_|> returning: returns the count, exits if /proc/self/io cannot be read
+
+    FILE *fptr = fopen("/proc/self/io", "r");
+    char line[256];
+    long count = -1;
+    while (fptr != NULL && fgets(line, sizeof(line), fptr) != NULL) {
+        if (strncmp(line, "syscw:", 6) == 0) {count = atol(line + 6);}
+    }
+    if (fptr != NULL) {fclose(fptr);}
+    if (count == -1) {
+        fprintf(stderr, "Cannot read /proc/self/io\n");
+        exit(1);
+    }
+    return count;
+}
+
+void run(const char *tool, const char *root, int samples, long *bytes, long *writes){
+    //_|> descry: runs the monitor once with its output on a pty in raw mode, counting the bytes it draws and the writes it makes
+    //_|> tool: myMonitoringTool binary
+    //_|> root: tree root for --proc-root and --sys-root
+    //_|> samples: samples to take
+    //_|> bytes, writes: filled with the totals of the run
+    ///_|> returning: returns nothing, exits if the tool cannot be run
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master == -1 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        fprintf(stderr, "Cannot open a pty\n");
+        exit(1);
+    }
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    struct termios mode;
+    if (slave == -1 || tcgetattr(slave, &mode) != 0) {
+        fprintf(stderr, "Cannot open a pty\n");
+        exit(1);
+    }
+
+    // no newline translation, the bytes read are the bytes written
+    mode.c_oflag &= ~OPOST;
+    tcsetattr(slave, TCSANOW, &mode);
+
+    char samples_arg[32], proc_arg[PATH_BUFFER], sys_arg[PATH_BUFFER];
+    snprintf(samples_arg, sizeof(samples_arg), "%d", samples);
+    snprintf(proc_arg, sizeof(proc_arg), "--proc-root=%s/proc", root);
+    snprintf(sys_arg, sizeof(sys_arg), "--sys-root=%s/sys", root);
+    char *argv[] = {(char *)tool, samples_arg, TDELAY, proc_arg, sys_arg, NULL};
+
+    long before = read_syscw();
+    pid_t child = fork();
+    if (child == -1) {
+        fprintf(stderr, "Cannot fork\n");
+        exit(1);
+    }
+    if (child == 0) {
+        dup2(slave, STDOUT_FILENO);
+        close(slave);
+        close(master);
+        execv(tool, argv);
+        _exit(127);
+    }
+    close(slave);
+
+    // reading the master fails with EIO once the tool has exited and closed the slave
+    char buf[READ_BUFFER];
+    ssize_t got;
+    *bytes = 0;
+    while ((got = read(master, buf, sizeof(buf))) > 0 || (got == -1 && errno == EINTR)) {
+        if (got > 0) {*bytes += got;}
+    }
+    int status;
+    waitpid(child, &status, 0);
+    *writes = read_syscw() - before;
+    close(master);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s failed\n", tool);
+        exit(1);
+    }
+}
@@ -0,0 +1,161 @@
+// the monitor's own sampler is benchmarked, its main is renamed out of the way
+#define main monitor_main
+#include "../myMonitoringTool.c"
+#undef main
+#include <time.h>
+#include <sys/sysinfo.h>
+
+#define DEFAULT_ROUNDS 100000 // samples timed per sampler
+#define STAT_LINE 128 // bytes of one synthetic cpu line
+
+double elapsed_ns(struct timespec* start);
+void legacy_sample(long *total, long *idle, double *used_ram);
+void persistent_sample(sampler *smp, long *total, long *idle, double *used_ram);
+char *synthetic_stat(int cores, long tick);
+void time_cores(int cores, int rounds);
+
+
+int main(int argc, char *argv[]){
+    ///_|> descry: times one cpu and memory sample of myMonitoringTool, reopening /proc/stat with fopen, fgets and sscanf as it used to against the persistent pread sampler
+    ///_|> argc: argument count
+    ///_|> argv: [ROUNDS] [PROC_ROOT], the old path always reads /proc
+    ///_|> returning: return 0 after both runs
+
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    if (rounds < 1) {
+        fprintf(stderr, "usage: benchsample [ROUNDS] [PROC_ROOT]\n");
+        exit(1);
+    }
+    if (argc > 2) {proc_root = argv[2];}
+
+    long total = 0, idle = 0;
+    double used_ram = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < rounds; i++) {
+        legacy_sample(&total, &idle, &used_ram);
+    }
+    double legacy = elapsed_ns(&start) / rounds;
+
+    sampler smp;
+    open_sampler(&smp);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < rounds; i++) {
+        persistent_sample(&smp, &total, &idle, &used_ram);
+    }
+    double persistent = elapsed_ns(&start) / rounds;
+    close_sampler(&smp);
+
+    printf("  sampler        ns/sample\n");
+    printf("  fopen+sscanf   %.0f\n", legacy);
+    printf("  pread+scan     %.0f (%.1fx)\n", persistent, persistent > 0 ? legacy / persistent : 0);
+
+    // parse and usage pass alone on synthetic /proc/stat text, what the sampler adds per core
+    printf("\n  cores   ns/sample  ns/core\n");
+    int cores[] = {4, 64, 256, 1024};
+    for (size_t i = 0; i < sizeof(cores) / sizeof(cores[0]); i++) {
+        time_cores(cores[i], rounds / 10 > 0 ? rounds / 10 : 1);
+    }
+    return 0;
+}
+
+double elapsed_ns(struct timespec* start){
+    //_|> descry: nanoseconds since start on the monotonic clock
+    //_|> start: start time
+    ///_|> returning: returns the nanoseconds
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) * 1e9 + (double)(now.tv_nsec - start->tv_nsec);
+}
+
+void legacy_sample(long *total, long *idle, double *used_ram){
+    //_|> descry: one sample the way myMonitoringTool took it before the sampler layer, reopening /proc/stat, sscanf of the cpu line and sysinfo
+    //_|> total, idle: filled with the cpu times
+    //_|> used_ram: filled with the used memory in GB
+    ///_|> returning: returns nothing, exits if /proc/stat cannot be read
+
+    FILE *file = fopen("/proc/stat", "r");
+    if (file == NULL) {
+        fprintf(stderr, "/proc/stat not working\n");
+        exit(1);
+    }
+    char buffer[BUFFER];
+    if (fgets(buffer, sizeof(buffer), file) == NULL) {buffer[0] = '\0';}
+    fclose(file);
+
+    long user, nice, system, idle_time, iowait, irq, softirq, steal, guest, guest_nice;
+    user = nice = system = idle_time = iowait = irq = softirq = steal = guest = guest_nice = 0;
+    sscanf(buffer, "cpu %ld %ld %ld %ld %ld %ld %ld %ld %ld %ld",
+           &user, &nice, &system, &idle_time, &iowait, &irq, &softirq, &steal, &guest, &guest_nice);
+    *total = user + nice + system + idle_time + iowait + irq + softirq + steal + guest + guest_nice;
+    *idle = idle_time + iowait;
+
+    struct sysinfo info;
+    if (sysinfo(&info) == 0) {
+        *used_ram = ((info.totalram - info.freeram) * info.mem_unit) / (double)GIGABYTE;
+    }
+}
+
+void persistent_sample(sampler *smp, long *total, long *idle, double *used_ram){
+    //_|> descry: one sample through the monitor's sampler, pread of the already open /proc/stat and sysinfo
+    //_|> smp: open sampler
+    //_|> total, idle: filled with the cpu times
+    //_|> used_ram: filled with the used memory in GB
+    ///_|> returning: returns nothing
+
+    double total_ram;
+    get_cpu_usage(smp);
+    *total = smp->times[smp->current].user[0];
+    *idle = smp->times[smp->current].idle[0];
+    get_memory_usage(&total_ram, used_ram);
+}
+
+char *synthetic_stat(int cores, long tick){
+    //_|> descry: /proc/stat text with the aggregate cpu line and cores cpuN lines, every counter grown by tick
+    //_|> cores: cpuN lines to write
+    //_|> tick: added to the counters so two texts differ like two samples
+    ///_|> returning: returns the malloc'd text, exits if out of memory
+
+    size_t size = (size_t)(cores + 1) * STAT_LINE;
+    char *text = (char *)malloc(size);
+    if (text == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    size_t len = (size_t)snprintf(text, size, "cpu  %ld 0 %ld %ld 100 0 50 0 0 0\n", 4000 + tick * 3, 2000 + tick, 90000 + tick * 6);
+    for (int cpu = 0; cpu < cores; cpu++) {
+        len += (size_t)snprintf(text + len, size - len, "cpu%d %ld 0 %ld %ld 25 0 12 0 0 0\n", cpu, 1000 + tick * (cpu % 7), 500 + tick, 22500 + tick * 2);
+    }
+    return text;
+}
+
+void time_cores(int cores, int rounds){
+    //_|> descry: times parse_cpu_times and calculate_cpu_usage over two alternating synthetic /proc/stat texts and prints one row
+    //_|> cores: cpuN lines in the texts
+    //_|> rounds: samples timed
+    ///_|> returning: returns nothing
+
+    char *texts[2] = {synthetic_stat(cores, 0), synthetic_stat(cores, 10)};
+    sampler smp;
+    memset(&smp, 0, sizeof(smp));
+    grow_cpu_rows(&smp, CPU_ROWS_START);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < rounds; i++) {
+        int next = 1 - smp.current;
+        int rows = parse_cpu_times(&smp, &smp.times[next], texts[i % 2]);
+        calculate_cpu_usage(&smp.times[smp.current], &smp.times[next], smp.usage, rows);
+        smp.current = next;
+        smp.rows = rows;
+    }
+    double ns = elapsed_ns(&start) / rounds;
+    printf("  %-7d %-10.0f %.1f\n", cores, ns, ns / cores);
+
+    free(smp.times[0].user);
+    free(smp.times[1].user);
+    free(smp.usage);
+    free(texts[0]);
+    free(texts[1]);
+}
@@ -0,0 +1,149 @@
+#define _DEFAULT_SOURCE // kill
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define READ_BUFFER 65536 // bytes read from the tool's output at a time
+#define PATH_BUFFER (PATH_MAX + 64) // a file under the directory
+
+double elapsed(struct timespec* start);
+pid_t hold_files(const char *dir, int fds);
+void run(char *tool, pid_t holder, const char *engine);
+
+
+int main(int argc, char *argv[]){
+    ///_|> descry: benchmarks the --engine=sync and --engine=uring stat engines of showFDtables on a process holding FDS files open in DIR
+    ///_|> argc: argument count
+    ///_|> argv: SHOWFDTABLES DIR FDS
+    ///_|> returning: return 0 after both runs
+
+    if (argc != 4 || atoi(argv[3]) < 1) {
+        fprintf(stderr, "usage: benchstat SHOWFDTABLES DIR FDS\n");
+        exit(1);
+    }
+    pid_t holder = hold_files(argv[2], atoi(argv[3]));
+    printf("  engine   fds        seconds   fds/sec\n");
+    run(argv[1], holder, "--engine=sync");
+    run(argv[1], holder, "--engine=uring");
+    kill(holder, SIGKILL);
+    waitpid(holder, NULL, 0);
+    return 0;
+}
+
+double elapsed(struct timespec* start){
+    //_|> descry: seconds since start on the monotonic clock
+    //_|> start: start time
+    ///_|> returning: returns the seconds
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+pid_t hold_files(const char *dir, int fds){
+    //_|> descry: starts a process that opens f0..fN-1 in dir, creating the ones that are missing, and keeps them open until killed
+    //_|> dir: directory of the files
+    //_|> fds: number of files
+    ///_|> returning: returns the holder's pid once every file is open, exits if it could not open them
+
+    int ready[2];
+    if (pipe(ready) != 0) {
+        fprintf(stderr, "Cannot create pipe\n");
+        exit(1);
+    }
+    pid_t child = fork();
+    if (child == -1) {
+        fprintf(stderr, "Cannot fork\n");
+        exit(1);
+    }
+    if (child == 0) {
+        close(ready[0]);
+        struct rlimit limit;
+        getrlimit(RLIMIT_NOFILE, &limit);
+        if (limit.rlim_cur < (rlim_t)fds + 64) {
+            limit.rlim_cur = limit.rlim_max < (rlim_t)fds + 64 ? limit.rlim_max : (rlim_t)fds + 64;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+        for (int k = 0; k < fds; k++) {
+            char path[PATH_BUFFER];
+            snprintf(path, sizeof(path), "%s/f%d", dir, k);
+            int fd = open(path, O_RDONLY);
+            if (fd == -1) {fd = open(path, O_RDONLY | O_CREAT, 0644);}
+            if (fd == -1) {_exit(1);}
+        }
+        if (write(ready[1], "1", 1) != 1) {_exit(1);}
+        while (1) {
+            pause();
+        }
+    }
+    close(ready[1]);
+    char byte;
+    if (read(ready[0], &byte, 1) != 1) {
+        fprintf(stderr, "Cannot open %d files in %s\n", fds, dir);
+        exit(1);
+    }
+    close(ready[0]);
+    return child;
+}
+
+void run(char *tool, pid_t holder, const char *engine){
+    //_|> descry: runs the tool once as csv on the holder with one engine, counting the rows it prints
+    //_|> tool: showFDtables binary
+    //_|> holder: pid holding the files
+    //_|> engine: --engine argument
+    ///_|> returning: returns nothing, exits if the tool cannot be run
+
+    char pid_arg[32];
+    snprintf(pid_arg, sizeof(pid_arg), "%d", (int)holder);
+    char *argv[] = {tool, pid_arg, (char *)engine, "--format=csv", NULL};
+
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        fprintf(stderr, "Cannot create pipe\n");
+        exit(1);
+    }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t child = fork();
+    if (child == -1) {
+        fprintf(stderr, "Cannot fork\n");
+        exit(1);
+    }
+    if (child == 0) {
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        execv(tool, argv);
+        _exit(127);
+    }
+    close(pipe_fds[1]);
+
+    // the first line is the csv header, every line after it is one fd
+    char buf[READ_BUFFER];
+    long lines = 0;
+    ssize_t got;
+    while ((got = read(pipe_fds[0], buf, sizeof(buf))) > 0) {
+        for (char *pos = buf; (pos = memchr(pos, '\n', buf + got - pos)) != NULL; pos++) {
+            lines++;
+        }
+    }
+    close(pipe_fds[0]);
+
+    int status;
+    waitpid(child, &status, 0);
+    double total = elapsed(&start);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s failed\n", tool);
+        exit(1);
+    }
+    long fds = lines > 0 ? lines - 1 : 0;
+    printf("  %-8s %-10ld %-9.3f %.0f\n", engine + 9, fds, total, total > 0 ? fds / total : 0);
+}
@@ -0,0 +1,156 @@
+#define _DEFAULT_SOURCE // symlink, realpath
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#define FIRST_PID 1000 // pid of the first synthetic process
+#define NCPUS 4 // processors listed in the synthetic cpuinfo and stat
+#define PATH_BUFFER (PATH_MAX + 64) // a path under the root, room for the root and what follows it
+
+void make_dir(const char *path);
+void write_file(const char *path, const char *contents);
+void make_system(const char *root);
+void make_pid(const char *root, int pid, int pid_index, int fds, int paths);
+
+
+int main(int argc, char *argv[]){
+    ///_|> descry: builds a synthetic procfs-like tree for benchmarking showFDtables and myMonitoringTool with --proc-root and --sys-root
+    ///_|> argc: argument count
+    ///_|> argv: ROOT PIDS FDS_PER_PID PATHS
+    ///_|> returning: return 0 once the tree is built
+
+    if (argc != 5) {
+        fprintf(stderr, "usage: genproc ROOT PIDS FDS_PER_PID PATHS\n");
+        exit(1);
+    }
+    int pids = atoi(argv[2]);
+    int fds = atoi(argv[3]);
+    int paths = atoi(argv[4]);
+    if (pids < 1 || fds < 0 || paths < 1) {
+        fprintf(stderr, "PIDS and PATHS must be at least 1\n");
+        exit(1);
+    }
+
+    // fd links point at files by absolute path, so resolve the root first
+    make_dir(argv[1]);
+    char root[PATH_MAX];
+    if (realpath(argv[1], root) == NULL) {
+        fprintf(stderr, "Cannot resolve %s\n", argv[1]);
+        exit(1);
+    }
+
+    // PATHS distinct files, shared by every fd that maps to them
+    char path[PATH_BUFFER];
+    snprintf(path, sizeof(path), "%s/files", root);
+    make_dir(path);
+    for (int k = 0; k < paths; k++) {
+        snprintf(path, sizeof(path), "%s/files/f%d", root, k);
+        write_file(path, "");
+    }
+
+    make_system(root);
+    for (int i = 0; i < pids; i++) {
+        make_pid(root, FIRST_PID + i, i, fds, paths);
+    }
+    printf("%s: %d pids x %d fds = %ld fds over %d paths\n", root, pids, fds, (long)pids * fds, paths);
+    return 0;
+}
+
+void make_dir(const char *path){
+    //_|> descry: creates a directory, an existing one is fine
+    //_|> path: directory to create
+    ///_|> returning: returns nothing, exits on error
+
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create %s\n", path);
+        exit(1);
+    }
+}
+
+void write_file(const char *path, const char *contents){
+    //_|> descry: creates or overwrites a file with contents
+    //_|> path: file to write
+    //_|> contents: text to write
+    ///_|> returning: returns nothing, exits on error
+
+    FILE *fptr = fopen(path, "w");
+    if (fptr == NULL) {
+        fprintf(stderr, "Cannot create %s\n", path);
+        exit(1);
+    }
+    fputs(contents, fptr);
+    fclose(fptr);
+}
+
+void make_system(const char *root){
+    //_|> descry: writes the system wide files myMonitoringTool reads, proc/stat, proc/cpuinfo and the cpu0 max frequency under sys
+    //_|> root: tree root
+    ///_|> returning: returns nothing
+
+    char path[PATH_BUFFER];
+    char text[4096];
+    snprintf(path, sizeof(path), "%s/proc", root);
+    make_dir(path);
+
+    size_t len = snprintf(text, sizeof(text), "cpu  4000 0 2000 90000 100 0 50 0 0 0\n");
+    for (int cpu = 0; cpu < NCPUS; cpu++) {
+        len += snprintf(text + len, sizeof(text) - len, "cpu%d 1000 0 500 22500 25 0 12 0 0 0\n", cpu);
+    }
+    snprintf(path, sizeof(path), "%s/proc/stat", root);
+    write_file(path, text);
+
+    len = 0;
+    for (int cpu = 0; cpu < NCPUS; cpu++) {
+        len += snprintf(text + len, sizeof(text) - len, "processor\t: %d\nmodel name\t: synthetic\n\n", cpu);
+    }
+    snprintf(path, sizeof(path), "%s/proc/cpuinfo", root);
+    write_file(path, text);
+
+    const char *dirs[] = {"sys", "sys/devices", "sys/devices/system", "sys/devices/system/cpu", "sys/devices/system/cpu/cpu0", "sys/devices/system/cpu/cpu0/cpufreq"};
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", root, dirs[i]);
+        make_dir(path);
+    }
+    snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", root);
+    write_file(path, "3000000\n");
+}
+
+void make_pid(const char *root, int pid, int pid_index, int fds, int paths){
+    //_|> descry: writes one synthetic process, comm, cgroup, limits and an fd directory of links into the shared files
+    //_|> root: tree root
+    //_|> pid: pid to create
+    //_|> pid_index: index of the pid, spreads its fds over the files
+    //_|> fds: fds to create
+    //_|> paths: number of shared files
+    ///_|> returning: returns nothing
+
+    char path[PATH_BUFFER];
+    char target[PATH_BUFFER];
+    char text[256];
+    snprintf(path, sizeof(path), "%s/proc/%d", root, pid);
+    make_dir(path);
+
+    snprintf(path, sizeof(path), "%s/proc/%d/comm", root, pid);
+    snprintf(text, sizeof(text), "synth%d\n", pid_index % 16);
+    write_file(path, text);
+    snprintf(path, sizeof(path), "%s/proc/%d/cgroup", root, pid);
+    snprintf(text, sizeof(text), "0::/synth/service%d\n", pid_index % 8);
+    write_file(path, text);
+    snprintf(path, sizeof(path), "%s/proc/%d/limits", root, pid);
+    write_file(path, "Limit                     Soft Limit           Hard Limit           Units     \nMax open files            1048576              1048576              files     \n");
+
+    snprintf(path, sizeof(path), "%s/proc/%d/fd", root, pid);
+    make_dir(path);
+    for (int fd = 0; fd < fds; fd++) {
+        snprintf(path, sizeof(path), "%s/proc/%d/fd/%d", root, pid, fd);
+        snprintf(target, sizeof(target), "%s/files/f%ld", root, ((long)pid_index * fds + fd) % paths);
+        if (symlink(target, path) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Cannot create %s\n", path);
+            exit(1);
+        }
+    }
+}
@@ -0,0 +1,191 @@
+#define _DEFAULT_SOURCE // usleep, setsid
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <linux/fuse.h>
+
+#define THREADS 64 // requests served at once, so parallel stats really overlap
+#define READ_BUFFER (135168) // bytes per /dev/fuse read, has to hold a request of max_write bytes
+#define MAX_WRITE 4096 // largest write the kernel sends, nothing is written here anyway
+#define NODE_FIRST 2 // node id of f0, ids below are the root
+
+//Shared by every serving thread
+typedef struct slowfs {
+    int dev_fd;
+    int files;
+    int delay_us;
+} slowfs;
+
+void *serve(void *arg);
+void reply(int dev_fd, uint64_t unique, int error, const void *payload, size_t len);
+void fill_attr(uint64_t node, struct fuse_attr* attr);
+
+
+int main(int argc, char *argv[]){
+    ///_|> descry: mounts a flat FUSE filesystem of FILES empty files f0..fN-1 whose getattr answers after DELAY_US, a slow network filesystem stand-in for benchmarking stat engines
+    ///_|> argc: argument count
+    ///_|> argv: MOUNTPOINT FILES DELAY_US
+    ///_|> returning: returns 0 once mounted, a background process serves until the filesystem is unmounted
+
+    if (argc != 4) {
+        fprintf(stderr, "usage: slowfs MOUNTPOINT FILES DELAY_US\n");
+        exit(1);
+    }
+    slowfs fs;
+    fs.files = atoi(argv[2]);
+    fs.delay_us = atoi(argv[3]);
+    if (fs.files < 1 || fs.delay_us < 0) {
+        fprintf(stderr, "FILES must be at least 1\n");
+        exit(1);
+    }
+
+    fs.dev_fd = open("/dev/fuse", O_RDWR | O_CLOEXEC);
+    if (fs.dev_fd == -1) {
+        fprintf(stderr, "Cannot open /dev/fuse\n");
+        exit(1);
+    }
+    char options[256];
+    snprintf(options, sizeof(options), "fd=%d,rootmode=40000,user_id=%d,group_id=%d,allow_other", fs.dev_fd, (int)getuid(), (int)getgid());
+    if (mount("slowfs", argv[1], "fuse.slowfs", MS_NOSUID | MS_NODEV, options) != 0) {
+        fprintf(stderr, "Cannot mount %s: %s\n", argv[1], strerror(errno));
+        exit(1);
+    }
+
+    // mounted, serve from a detached child so the caller can go on
+    pid_t child = fork();
+    if (child == -1) {
+        fprintf(stderr, "Cannot fork\n");
+        exit(1);
+    }
+    if (child > 0) {return 0;}
+    setsid();
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        if (pthread_create(&threads[i], NULL, serve, &fs) != 0) {
+            fprintf(stderr, "Cannot create thread\n");
+            exit(1);
+        }
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return 0;
+}
+
+void *serve(void *arg){
+    ///_|> descry: serving thread, reads requests from /dev/fuse and answers the few a flat read only filesystem needs
+    ///_|> arg: shared slowfs
+    ///_|> returning: returns NULL once the filesystem is unmounted
+
+    slowfs *fs = (slowfs *)arg;
+    char *buf = (char *)malloc(READ_BUFFER);
+    if (buf == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    while (1) {
+        ssize_t got = read(fs->dev_fd, buf, READ_BUFFER);
+        if (got == -1 && (errno == EINTR || errno == ENOENT || errno == EAGAIN)) {continue;}
+        if (got < (ssize_t)sizeof(struct fuse_in_header)) {break;}
+        struct fuse_in_header *in = (struct fuse_in_header *)buf;
+        char *payload = buf + sizeof(struct fuse_in_header);
+
+        if (in->opcode == FUSE_INIT) {
+            struct fuse_init_in *init_in = (struct fuse_init_in *)payload;
+            struct fuse_init_out init;
+            memset(&init, 0, sizeof(init));
+            init.major = FUSE_KERNEL_VERSION;
+            init.minor = FUSE_KERNEL_MINOR_VERSION;
+            init.max_readahead = init_in->max_readahead;
+            init.max_write = MAX_WRITE;
+            init.time_gran = 1;
+            reply(fs->dev_fd, in->unique, 0, &init, sizeof(init));
+        } else if (in->opcode == FUSE_LOOKUP) {
+
+            // only f<k> exists, looked up in the root
+            int k = -1;
+            if (in->nodeid == FUSE_ROOT_ID && payload[0] == 'f') {
+                char *end;
+                long index = strtol(payload + 1, &end, 10);
+                if (end != payload + 1 && *end == '\0' && index >= 0 && index < fs->files) {k = (int)index;}
+            }
+            if (k == -1) {
+                reply(fs->dev_fd, in->unique, -ENOENT, NULL, 0);
+                continue;
+            }
+            struct fuse_entry_out entry;
+            memset(&entry, 0, sizeof(entry));
+            entry.nodeid = NODE_FIRST + k;
+            entry.entry_valid = 3600;
+            fill_attr(entry.nodeid, &entry.attr);
+            reply(fs->dev_fd, in->unique, 0, &entry, sizeof(entry));
+        } else if (in->opcode == FUSE_GETATTR) {
+
+            // attributes are never cached, so every stat of a file waits here
+            if (in->nodeid != FUSE_ROOT_ID) {usleep(fs->delay_us);}
+            struct fuse_attr_out attr;
+            memset(&attr, 0, sizeof(attr));
+            fill_attr(in->nodeid, &attr.attr);
+            reply(fs->dev_fd, in->unique, 0, &attr, sizeof(attr));
+        } else if (in->opcode == FUSE_OPEN) {
+            struct fuse_open_out open_out;
+            memset(&open_out, 0, sizeof(open_out));
+            reply(fs->dev_fd, in->unique, 0, &open_out, sizeof(open_out));
+        } else if (in->opcode == FUSE_RELEASE || in->opcode == FUSE_FLUSH || in->opcode == FUSE_DESTROY) {
+            reply(fs->dev_fd, in->unique, 0, NULL, 0);
+        } else if (in->opcode == FUSE_FORGET || in->opcode == FUSE_BATCH_FORGET || in->opcode == FUSE_INTERRUPT) {
+
+            // no reply expected
+        } else {
+            reply(fs->dev_fd, in->unique, -ENOSYS, NULL, 0);
+        }
+    }
+    free(buf);
+    return NULL;
+}
+
+void reply(int dev_fd, uint64_t unique, int error, const void *payload, size_t len){
+    //_|> descry: writes one reply to /dev/fuse, header and payload in a single write
+    //_|> dev_fd: /dev/fuse
+    //_|> unique: id of the request answered
+    //_|> error: 0 or a negative errno
+    //_|> payload, len: reply body
+    ///_|> returning: returns nothing
+
+    char out[sizeof(struct fuse_out_header) + sizeof(struct fuse_init_out) + sizeof(struct fuse_entry_out)];
+    struct fuse_out_header *header = (struct fuse_out_header *)out;
+    header->len = (uint32_t)(sizeof(struct fuse_out_header) + len);
+    header->error = error;
+    header->unique = unique;
+    if (len > 0) {memcpy(out + sizeof(struct fuse_out_header), payload, len);}
+    if (write(dev_fd, out, header->len) == -1 && errno != ENOENT) {
+        fprintf(stderr, "Error writing reply\n");
+    }
+}
+
+void fill_attr(uint64_t node, struct fuse_attr* attr){
+    //_|> descry: attributes of the root directory or of one empty file
+    //_|> node: node id
+    //_|> attr: filled with the attributes
+    ///_|> returning: returns nothing
+
+    memset(attr, 0, sizeof(*attr));
+    attr->ino = node;
+    attr->uid = getuid();
+    attr->gid = getgid();
+    attr->blksize = 4096;
+    if (node == FUSE_ROOT_ID) {
+        attr->mode = S_IFDIR | 0755;
+        attr->nlink = 2;
+    } else {
+        attr->mode = S_IFREG | 0644;
+        attr->nlink = 1;
+    }
+}
@@ -1,36 +1,197 @@
+#define _DEFAULT_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include <sys/sysinfo.h>
+#include <sys/prctl.h>
+#include <sys/ioctl.h>
 #include <ctype.h>
 #include <math.h>
 
 #define DEFAULT_SAMPLES 20
 #define DEFAULT_TDELAY 500000
 #define MIN_SAMPLES 1
-#define MIN_TDELAY 10000 // 10ms
+#define MIN_TDELAY 100 // 0.1ms, samples sleep to absolute deadlines so short periods do not drift, cpu times still only move every USER_HZ tick
+#define NANOSECONDS 1000000000L
 #define GIGABYTE 1073741824
 #define MEMORY_HEIGHT 12
 #define CPU_HEIGHT 10
 #define BUFFER 500
+#define PATH_BUFFER 4096 // bytes for a path under the proc or sys root
+#define SOURCE_BUFFER 4096 // first size of a sampler buffer, doubled until one pread holds the whole file
+#define CPU_COLUMNS 10 // user, nice, system, idle, iowait, irq, softirq, steal, guest, guest_nice
+#define CPU_ROWS_START 64 // cpu lines the sampler holds at first, doubled when /proc/stat lists more
+#define CORES_PER_ROW 4 // core boxes drawn side by side
+#define NO_USAGE -1.0f // usage of a row that has not ticked since it showed up, drawn as no data
+#define SCREEN_ROWS 40 // rows and columns of the first off-screen frame, it grows to whatever is drawn
+#define SCREEN_COLS 80
+#define FRAME_BUFFER 65536 // first size of the escape sequences of one frame
+#define FRAME_TDELAY 33333 // microseconds between frames, the renderer draws every sample taken since the last one
+#define RING_SLOTS 256 // samples in flight between the sampler and the renderer, a power of 2
+#define PENDING_START 64 // samples the sampler first keeps aside when the ring is full, doubled as needed
+
+// A procfs file kept open and re-read from offset 0 into the same buffer every sample
+typedef struct source
+{
+    int fd;
+    char *buf;
+    size_t size;
+} source;
+
+// Times of every cpu line of /proc/stat, row 0 is the aggregate cpu line and row k + 1 is core k
+// one array per column, so the usage pass reads each column contiguously however many cores there are
+typedef struct cputimes
+{
+    long *user, *nice, *system, *idle, *iowait, *irq, *softirq, *steal, *guest, *guest_nice;
+    char *present; // 1 if the row had a line in this sample, offline cores have none
+} cputimes;
+
+// The procfs files read every sample, opened once before the first one
+// memory comes from sysinfo, one syscall is cheaper than having the kernel format /proc/meminfo
+typedef struct sampler
+{
+    source stat;
+    cputimes times[2]; // the last two samples, times[current] is the newest
+    int current;
+    int rows;     // cpu lines in the newest sample
+    int cap;      // rows the times and usage arrays hold
+    float *usage; // busy percent of each row between the last two samples
+} sampler;
+
+// One character cell of the terminal, a UTF-8 glyph of up to 3 bytes
+typedef struct cell
+{
+    char glyph[4];
+} cell;
+
+// Off-screen copy of the terminal. Drawing only writes cells at the pen, flush_screen writes the cells
+// that differ from what the terminal shows as one run of escape sequences in a single write
+typedef struct screen
+{
+    cell *cells; // rows * cols, the frame being drawn
+    cell *shown; // rows * cols, what the terminal shows
+    int rows, cols;
+    int row, col;              // pen, where the next draw goes, 1-based like the escape sequences
+    int term_row, term_col;    // terminal cursor after the last frame, 0 if unknown
+    int cleared;               // the terminal has to be cleared before the next frame
+    char *out;                 // escape sequences of the frame being flushed
+    size_t out_len, out_size;
+} screen;
+
+// Sample deadlines on CLOCK_MONOTONIC, one every period from the start, so the time spent sampling
+// and drawing is not added to the period and the samples stay on a fixed grid
+typedef struct scheduler
+{
+    struct timespec deadline; // next deadline
+    long period;              // nanoseconds between deadlines
+    long waits;               // deadlines slept to
+    long missed;              // deadlines already past when the sample before them finished, skipped
+    long late_max;            // latest wake up after a deadline, nanoseconds
+    double late_sum;
+} scheduler;
+
+// One sample as the sampler thread hands it to the renderer, the per-core usage is stored beside it
+typedef struct sample
+{
+    struct timespec taken; // CLOCK_MONOTONIC
+    double total_ram, used_ram;
+    int rows;              // usage rows stored, row 0 is the aggregate cpu
+    double late_avg;       // sampler's scheduling up to this sample, microseconds
+    double late_max;
+    long missed;
+    long overruns;         // samples that found the ring full up to this one
+    const char *error;     // why sampling stopped, or NULL; the renderer prints it and exits, the sampler never draws
+} sample;
+
+// Samples from the sampler thread to the renderer without locks, one producer and one consumer:
+// the sampler only writes head and the renderer only writes tail, each on its own cache line
+typedef struct ring
+{
+    sample *slots;   // RING_SLOTS
+    float *usage;    // RING_SLOTS * rows, the usage of slot i starts at i * rows
+    int rows;
+    char head_line[64];
+    size_t head;     // samples pushed
+    char tail_line[64];
+    size_t tail;     // samples popped
+} ring;
+
+// Everything the sampler thread owns, the ring is the only part the renderer touches
+typedef struct sampling
+{
+    sampler smp;
+    scheduler sched;
+    ring queue;
+    int samples;          // samples to take
+    int tdelay;
+    sample *pending;      // samples the full ring had no room for, oldest first, they wait here instead of being dropped
+    float *pending_usage; // usage rows of each pending sample
+    size_t pending_first, pending_count, pending_cap;
+    long overruns;
+} sampling;
 
 void parse_arguments(int argc, char *argv[], int *samples, int *tdelay, int *show_memory, int *show_cpu, int *show_cores);
-void display_memory_usage(int sample_num);
+FILE *open_root(const char *root, const char *path);
+void open_sampler(sampler *smp);
+void close_sampler(sampler *smp);
+int open_source(source *src, const char *root, const char *path);
+size_t read_source(source *src);
+const char *scan_number(const char *pos, long *value);
+void grow_cpu_rows(sampler *smp, int need);
+int parse_cpu_times(sampler *smp, cputimes *times, const char *buf);
+void zero_cpu_rows(cputimes *times, int from, int to);
+void copy_cpu_row(cputimes *to, const cputimes *from, int row);
+int get_memory_usage(double *total_ram, double *used_ram);
+void display_memory_usage(const sample *entry, int sample_num);
 void clear_screen();
 void move_cursor_top();
 void shift_cursor(int rows, int cols);
 void move_cursor_position(int row, int col);
+void grow_screen(int rows, int cols);
+void draw(const char *format, ...);
+void emit(const char *text, size_t len);
+void flush_screen();
+void start_scheduler(scheduler *sched, int tdelay);
+void wait_deadline(scheduler *sched);
+void add_nanoseconds(struct timespec *time, long nanoseconds);
+long nanoseconds_between(const struct timespec *from, const struct timespec *to);
+void display_schedule(const sample *latest, const scheduler *frames, double lag);
+int terminal_width();
+void open_ring(ring *queue, int rows);
+void close_ring(ring *queue);
+int ring_push(ring *queue, const sample *entry, const float *usage);
+const sample *ring_peek(ring *queue);
+const float *ring_usage(ring *queue, const sample *entry);
+void ring_pop(ring *queue);
+void *sample_loop(void *arg);
+void hand_over(sampling *job, const sample *entry, const float *usage);
+void flush_pending(sampling *job);
 void draw_graph_outline(int width, int height);
 void draw_memory_graph(int *samples);
 void draw_cpu_graph(int *samples, int show_memory);
-void display_cpu_usage(int sample_num, int show_memory, long *prev_cpu_idle, long *prev_cpu_total);
-float calculate_cpu_usage(long prev_total, long prev_idle, long new_total, long new_idle);
-void get_cpu_usage(long *new_total, long *new_idle);
+void display_cpu_usage(const float *usage, int sample_num, int show_memory);
+void calculate_cpu_usage(const cputimes *prev, const cputimes *now, float *usage, int rows);
+int get_cpu_usage(sampler *smp);
+void exit_with_error(const char *message);
 void getCpuInfo(int *num_cores, float *max_frequency);
-void display_cores();
+int graphs_bottom(int show_memory, int show_cpu);
+int display_cores(int row);
+void display_core_usage(const float *usage, int rows, int row, int num_cores);
 void printsquare();
 
+// Where /proc and /sys are read from, --proc-root and --sys-root point them at a copy or a synthetic tree
+static const char *proc_root = "/proc";
+static const char *sys_root = "/sys";
+
+// Everything is drawn here first, see flush_screen
+static screen frame;
+
 int main(int argc, char *argv[])
 {
     int samples = DEFAULT_SAMPLES;
@@ -40,36 +201,94 @@ int main(int argc, char *argv[])
     parse_arguments(argc, argv, &samples, &tdelay, &show_memory, &show_cpu, &show_cores);
     clear_screen();
     move_cursor_top();
-    printf("Nbr of samples: %d -- every %d microSecs (%.3f secs)\n\n", samples, tdelay, (float)tdelay / 1000000);
+    draw("Nbr of samples: %d -- every %d microSecs (%.3f secs)\n\n", samples, tdelay, (float)tdelay / 1000000);
 
-    // If memory or CPU is shown, a loop is needed to update the graphs
-    if (show_memory || show_cpu)
+    // A loop is needed to update the graphs and the load of every core
+    if (show_memory || show_cpu || show_cores)
     {
         if (show_memory)
             draw_memory_graph(&samples);
         if (show_cpu)
             draw_cpu_graph(&samples, show_memory);
 
-        long prev_cpu_idle = 0, prev_cpu_total = 0;     // stores prev total and idle cpu time
-        get_cpu_usage(&prev_cpu_total, &prev_cpu_idle); // find the first cpu usage snapshot
-        usleep(tdelay);
+        // display core info under the graphs, each box then gets its core's load every sample
+        int cores_row = graphs_bottom(show_memory, show_cpu);
+        int num_cores = 0;
+        if (show_cores)
+            num_cores = display_cores(cores_row);
 
-        // continously update the graphs by looping through the samples
-        for (int sample_num = 0; sample_num < samples; sample_num++)
+        // the sampler thread samples every tdelay on its own deadlines, the first sample only sets the baseline
+        sampling job;
+        memset(&job, 0, sizeof(job));
+        job.samples = samples;
+        job.tdelay = tdelay;
+        open_sampler(&job.smp);
+        if (get_cpu_usage(&job.smp) != 0)
+            exit_with_error("/proc/stat not working\n");
+        open_ring(&job.queue, job.smp.rows);
+        pthread_t sampler_thread;
+        if (pthread_create(&sampler_thread, NULL, sample_loop, &job) != 0)
         {
-            if (show_memory)
-                display_memory_usage(sample_num);
-            if (show_cpu)
-                display_cpu_usage(sample_num, show_memory, &prev_cpu_idle, &prev_cpu_total);
+            printf("Error: cannot start the sampler thread\n");
+            exit(1);
+        }
+        flush_screen(); // the graphs and boxes show before the first sample arrives
 
-            fflush(stdout); // prevents output from not updating
-            usleep(tdelay); // pause for tdelay microseconds
+        // the renderer draws every sample taken since the last frame, so a slow terminal delays the
+        // drawing but never the samples or their timestamps
+        scheduler frames;
+        start_scheduler(&frames, FRAME_TDELAY);
+        sample latest;
+        float *latest_usage = (float *)malloc(job.queue.rows * sizeof(float)); // the core boxes only show the newest sample
+        if (latest_usage == NULL)
+        {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
         }
-    }
+        int sample_num = 0;
+        while (sample_num < samples)
+        {
+            wait_deadline(&frames);
+            int drawn = 0;
+            const sample *entry;
+            while ((entry = ring_peek(&job.queue)) != NULL)
+            {
+                if (entry->error != NULL)
+                    exit_with_error(entry->error);
+                const float *usage = ring_usage(&job.queue, entry);
+                if (show_memory)
+                    display_memory_usage(entry, sample_num);
+                if (show_cpu)
+                    display_cpu_usage(usage, sample_num, show_memory);
+                latest = *entry;
+                memcpy(latest_usage, usage, entry->rows * sizeof(float));
+                ring_pop(&job.queue);
+                sample_num++;
+                drawn++;
+            }
+            if (drawn == 0)
+                continue;
+            if (show_cores)
+                display_core_usage(latest_usage, latest.rows, cores_row, num_cores);
+
+            // how long the newest sample waited for this frame
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            display_schedule(&latest, &frames, nanoseconds_between(&latest.taken, &now) / 1000000.0);
+            flush_screen(); // one write of the cells that changed
+        }
+        pthread_join(sampler_thread, NULL);
+        free(latest_usage);
+        close_ring(&job.queue);
+        close_sampler(&job.smp);
+        free(job.pending);
+        free(job.pending_usage);
 
-    // display core info
-    if (show_cores)
-        display_cores();
+        // leave the cursor under the core boxes
+        if (show_cores)
+            move_cursor_position(cores_row + 2 + (num_cores + CORES_PER_ROW - 1) / CORES_PER_ROW * 3, 1);
+    }
+    flush_screen();
     return 0;
 }
 
@@ -119,6 +338,14 @@ void parse_arguments(int argc, char *argv[], int *samples, int *tdelay, int *sho
         {
             *tdelay = atoi(argv[arg_index] + 9);
         }
+        else if (strncmp(argv[arg_index], "--proc-root=", 12) == 0)
+        {
+            proc_root = argv[arg_index] + 12;
+        }
+        else if (strncmp(argv[arg_index], "--sys-root=", 11) == 0)
+        {
+            sys_root = argv[arg_index] + 11;
+        }
         else
         {
             printf("Error: Argument format wrong\n");
@@ -147,77 +374,671 @@ void parse_arguments(int argc, char *argv[], int *samples, int *tdelay, int *sho
     }
 }
 
-// Update Memory graph where sample_num is the current sample number
-void display_memory_usage(int sample_num)
+// Open /proc/stat once, every sample re-reads it with pread instead of reopening it
+void open_sampler(sampler *smp)
 {
-    struct sysinfo info;
-    if (sysinfo(&info) == 0)
-    { // store sys info in info, success reutrn 0
-        double total_ram = (info.totalram * info.mem_unit) / (double)GIGABYTE;
-        double free_ram = (info.freeram * info.mem_unit) / (double)GIGABYTE;
-        double used_ram = total_ram - free_ram;
-        int used_ram_percent = round((used_ram / total_ram) * 12); // round is used -lm flag needed
+    if (open_source(&smp->stat, proc_root, "stat") != 0)
+    {
+        clear_screen();
+        move_cursor_top();
+        draw("/proc/stat not working\n");
+        flush_screen();
+        exit(1);
+    }
+    memset(smp->times, 0, sizeof(smp->times));
+    smp->current = 0;
+    smp->rows = 0;
+    smp->cap = 0;
+    smp->usage = NULL;
+    grow_cpu_rows(smp, CPU_ROWS_START);
+}
 
-        // default position as memory is always first if shown
-        move_cursor_position(16, 9);
-        shift_cursor(-used_ram_percent, sample_num);
-        printf("#");
+void close_sampler(sampler *smp)
+{
+    close(smp->stat.fd);
+    free(smp->stat.buf);
+    free(smp->times[0].user);
+    free(smp->times[1].user);
+    free(smp->times[0].present);
+    free(smp->times[1].present);
+    free(smp->usage);
+}
 
-        // Print memory used top of graph
-        move_cursor_position(3, 11);
-        printf("%.2f", used_ram);
+// Open a file under the proc root and allocate its buffer, returns 0 on success
+int open_source(source *src, const char *root, const char *path)
+{
+    char full_path[PATH_BUFFER];
+    snprintf(full_path, sizeof(full_path), "%s/%s", root, path);
+    src->fd = open(full_path, O_RDONLY | O_CLOEXEC);
+    if (src->fd == -1)
+    {
+        return -1;
+    }
+    src->size = SOURCE_BUFFER;
+    src->buf = (char *)malloc(src->size);
+    if (src->buf == NULL)
+    {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    return 0;
+}
 
-        // Print memory total at left of graph
-        move_cursor_position(4, 1);
-        printf("%.2f", total_ram);
+// Read the whole file from offset 0 into the buffer and terminate it, returns the bytes read or 0 on failure
+// procfs builds the file again on every read at offset 0, so the buffer grows until a single pread holds it all
+size_t read_source(source *src)
+{
+    while (1)
+    {
+        ssize_t got = pread(src->fd, src->buf, src->size - 1, 0);
+        if (got <= 0)
+        {
+            return 0;
+        }
+        if ((size_t)got < src->size - 1)
+        {
+            src->buf[got] = '\0';
+            return (size_t)got;
+        }
 
-        // Move cursor to default position
-        move_cursor_position(17, 1);
+        // filled the buffer, the file may be longer
+        char *grown = (char *)realloc(src->buf, src->size * 2);
+        if (grown == NULL)
+        {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        src->buf = grown;
+        src->size *= 2;
     }
-    else
-    { // Error handling
-        clear_screen();
-        move_cursor_top();
-        printf("sysinfo failed, cannot retrieve memory usage\n");
+}
+
+// Read the next unsigned number after pos skipping blanks, returns the position after it or NULL if there is none
+const char *scan_number(const char *pos, long *value)
+{
+    while (*pos == ' ' || *pos == '\t')
+        pos++;
+    if (*pos < '0' || *pos > '9')
+        return NULL;
+
+    long number = 0;
+    while (*pos >= '0' && *pos <= '9')
+    {
+        number = number * 10 + (*pos - '0');
+        pos++;
+    }
+    *value = number;
+    return pos;
+}
+
+// Make room for need cpu rows in both samples and the usage, new rows start at 0
+void grow_cpu_rows(sampler *smp, int need)
+{
+    int cap = smp->cap == 0 ? CPU_ROWS_START : smp->cap;
+    while (cap < need)
+        cap *= 2;
+    if (cap == smp->cap)
+        return;
+
+    for (int t = 0; t < 2; t++)
+    {
+        // one block per sample, column c takes rows [c * cap, (c + 1) * cap)
+        cputimes *times = &smp->times[t];
+        long **columns[CPU_COLUMNS] = {&times->user, &times->nice, &times->system, &times->idle, &times->iowait,
+                                       &times->irq, &times->softirq, &times->steal, &times->guest, &times->guest_nice};
+        long *block = (long *)calloc((size_t)cap * CPU_COLUMNS, sizeof(long));
+        if (block == NULL)
+        {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        for (int c = 0; c < CPU_COLUMNS; c++)
+        {
+            if (smp->cap > 0)
+                memcpy(block + (size_t)c * cap, *columns[c], (size_t)smp->cap * sizeof(long));
+        }
+        free(times->user);
+        for (int c = 0; c < CPU_COLUMNS; c++)
+            *columns[c] = block + (size_t)c * cap;
+
+        char *present = (char *)realloc(times->present, (size_t)cap);
+        if (present == NULL)
+        {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        memset(present + smp->cap, 0, (size_t)(cap - smp->cap));
+        times->present = present;
+    }
+
+    float *usage = (float *)realloc(smp->usage, (size_t)cap * sizeof(float));
+    if (usage == NULL)
+    {
+        fprintf(stderr, "Insufficient memory");
         exit(1);
     }
+    memset(usage + smp->cap, 0, (size_t)(cap - smp->cap) * sizeof(float));
+    smp->usage = usage;
+    smp->cap = cap;
+}
+
+// Parse the cpu lines at the top of /proc/stat into times, returns the number of rows or 0 without an aggregate cpu line
+// older kernels print fewer columns, the missing ones count as 0, and offline cores have no line, their rows are zeroed
+int parse_cpu_times(sampler *smp, cputimes *times, const char *buf)
+{
+    if (strncmp(buf, "cpu ", 4) != 0)
+        return 0;
+
+    int rows = 0;
+    const char *pos = buf;
+    while (strncmp(pos, "cpu", 3) == 0)
+    {
+        // "cpu" is row 0, "cpuN" is row N + 1
+        pos += 3;
+        long core = -1;
+        if (*pos != ' ')
+        {
+            pos = scan_number(pos, &core);
+            if (pos == NULL)
+                break;
+        }
+        int row = (int)core + 1;
+        if (row >= smp->cap)
+            grow_cpu_rows(smp, row + 1);
+        if (row > rows)
+            zero_cpu_rows(times, rows, row);
+
+        long *columns[CPU_COLUMNS] = {times->user, times->nice, times->system, times->idle, times->iowait,
+                                      times->irq, times->softirq, times->steal, times->guest, times->guest_nice};
+        for (int c = 0; c < CPU_COLUMNS; c++)
+        {
+            long value = 0;
+            const char *next = scan_number(pos, &value);
+            if (next != NULL)
+                pos = next;
+            columns[c][row] = value;
+        }
+        times->present[row] = 1;
+        if (row + 1 > rows)
+            rows = row + 1;
+
+        pos = strchr(pos, '\n');
+        if (pos == NULL)
+            break;
+        pos++;
+    }
+    zero_cpu_rows(times, rows, smp->cap);
+    return rows;
+}
+
+// Zero rows [from, to) of every column and mark them absent, so a core missing from /proc/stat does not keep the times of an older sample
+void zero_cpu_rows(cputimes *times, int from, int to)
+{
+    long *columns[CPU_COLUMNS] = {times->user, times->nice, times->system, times->idle, times->iowait,
+                                  times->irq, times->softirq, times->steal, times->guest, times->guest_nice};
+    for (int c = 0; c < CPU_COLUMNS; c++)
+        memset(columns[c] + from, 0, (size_t)(to - from) * sizeof(long));
+    memset(times->present + from, 0, (size_t)(to - from));
+}
+
+// Copy the times of one row, the present flag stays as it is
+void copy_cpu_row(cputimes *to, const cputimes *from, int row)
+{
+    long *dst[CPU_COLUMNS] = {to->user, to->nice, to->system, to->idle, to->iowait,
+                              to->irq, to->softirq, to->steal, to->guest, to->guest_nice};
+    const long *src[CPU_COLUMNS] = {from->user, from->nice, from->system, from->idle, from->iowait,
+                                    from->irq, from->softirq, from->steal, from->guest, from->guest_nice};
+    for (int c = 0; c < CPU_COLUMNS; c++)
+        dst[c][row] = src[c][row];
+}
+
+// Total and used memory in GB from sysinfo, returns 0 on success
+int get_memory_usage(double *total_ram, double *used_ram)
+{
+    struct sysinfo info;
+    if (sysinfo(&info) != 0)
+    {
+        return -1;
+    }
+    *total_ram = (info.totalram * info.mem_unit) / (double)GIGABYTE;
+    *used_ram = *total_ram - (info.freeram * info.mem_unit) / (double)GIGABYTE;
+    return 0;
 }
 
+// Update Memory graph where sample_num is the current sample number
+void display_memory_usage(const sample *entry, int sample_num)
+{
+    double total_ram = entry->total_ram, used_ram = entry->used_ram;
+    int used_ram_percent = round((used_ram / total_ram) * 12); // round is used -lm flag needed
+
+    // default position as memory is always first if shown
+    move_cursor_position(16, 9);
+    shift_cursor(-used_ram_percent, sample_num);
+    draw("#");
+
+    // Print memory used top of graph
+    move_cursor_position(3, 11);
+    draw("%.2f", used_ram);
+
+    // Print memory total at left of graph
+    move_cursor_position(4, 1);
+    draw("%.2f", total_ram);
+
+    // Move cursor to default position
+    move_cursor_position(17, 1);
+}
+
+// Blank the frame, the terminal itself is cleared with the next flush
 void clear_screen()
 {
-    printf("\033[2J");
+    if (frame.cells == NULL)
+        grow_screen(SCREEN_ROWS, SCREEN_COLS);
+    for (int i = 0; i < frame.rows * frame.cols; i++)
+        strcpy(frame.cells[i].glyph, " ");
+    frame.cleared = 1;
 }
 
 void move_cursor_top()
 {
-    printf("\033[H");
+    frame.row = 1;
+    frame.col = 1;
 }
 
-void move_cursor_pos(int row, int col)
+void move_cursor_position(int row, int col)
 {
-    printf("\033[%d;%dH", row, col);
+    frame.row = row;
+    frame.col = col;
 }
 
 // Move cursor by 'rows' and 'cols', rows positive moves down, negative moves up, cols positive moves right, negative moves left
+// like the terminal, the cursor stops at the top and left edges
 void shift_cursor(int rows, int cols)
 {
-    if (rows < 0)
+    frame.row = frame.row + rows < 1 ? 1 : frame.row + rows;
+    frame.col = frame.col + cols < 1 ? 1 : frame.col + cols;
+}
+
+// Make the frame at least rows by cols, new cells are blank on both copies
+void grow_screen(int rows, int cols)
+{
+    if (rows <= frame.rows && cols <= frame.cols)
+        return;
+    int new_rows = frame.rows > rows ? frame.rows : rows;
+    int new_cols = frame.cols > cols ? frame.cols : cols;
+    if (frame.rows > 0 && new_rows > frame.rows && new_rows < frame.rows * 2)
+        new_rows = frame.rows * 2;
+    if (frame.cols > 0 && new_cols > frame.cols && new_cols < frame.cols * 2)
+        new_cols = frame.cols * 2;
+
+    cell *cells = (cell *)malloc((size_t)new_rows * new_cols * sizeof(cell));
+    cell *shown = (cell *)malloc((size_t)new_rows * new_cols * sizeof(cell));
+    if (cells == NULL || shown == NULL)
+    {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    for (int r = 0; r < new_rows; r++)
+    {
+        for (int c = 0; c < new_cols; c++)
+        {
+            int inside = r < frame.rows && c < frame.cols;
+            cells[r * new_cols + c] = inside ? frame.cells[r * frame.cols + c] : (cell){" "};
+            shown[r * new_cols + c] = inside ? frame.shown[r * frame.cols + c] : (cell){" "};
+        }
+    }
+    free(frame.cells);
+    free(frame.shown);
+    frame.cells = cells;
+    frame.shown = shown;
+    frame.rows = new_rows;
+    frame.cols = new_cols;
+}
+
+// printf into the frame at the pen, a newline moves the pen to the start of the next row
+void draw(const char *format, ...)
+{
+    char text[BUFFER];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    for (const char *pos = text; *pos != '\0';)
+    {
+        if (*pos == '\n')
+        {
+            frame.row++;
+            frame.col = 1;
+            pos++;
+            continue;
+        }
+
+        // a glyph is one byte, or a UTF-8 lead byte and its continuation bytes
+        int len = 1;
+        while (len < 3 && ((unsigned char)*pos & 0xC0) == 0xC0 && ((unsigned char)pos[len] & 0xC0) == 0x80)
+            len++;
+        grow_screen(frame.row, frame.col);
+        cell *target = &frame.cells[(frame.row - 1) * frame.cols + frame.col - 1];
+        memcpy(target->glyph, pos, len);
+        target->glyph[len] = '\0';
+        frame.col++;
+        pos += len;
+    }
+}
+
+// Append to the escape sequences of the frame being flushed
+void emit(const char *text, size_t len)
+{
+    if (frame.out_len + len > frame.out_size)
+    {
+        size_t size = frame.out_size == 0 ? FRAME_BUFFER : frame.out_size;
+        while (size < frame.out_len + len)
+            size *= 2;
+        char *grown = (char *)realloc(frame.out, size);
+        if (grown == NULL)
+        {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        frame.out = grown;
+        frame.out_size = size;
+    }
+    memcpy(frame.out + frame.out_len, text, len);
+    frame.out_len += len;
+}
+
+// Write the cells that changed since the last frame, then the cursor at the pen, in one write
+void flush_screen()
+{
+    char move[32];
+    frame.out_len = 0;
+    if (frame.cleared)
+    {
+        emit("\033[2J", 4);
+        for (int i = 0; i < frame.rows * frame.cols; i++)
+            strcpy(frame.shown[i].glyph, " ");
+        frame.term_row = 0;
+        frame.cleared = 0;
+    }
+
+    for (int r = 1; r <= frame.rows; r++)
+    {
+        for (int c = 1; c <= frame.cols; c++)
+        {
+            int at = (r - 1) * frame.cols + c - 1;
+            if (strcmp(frame.cells[at].glyph, frame.shown[at].glyph) == 0)
+                continue;
+
+            // get the terminal cursor here with the fewest bytes: on the same row, rewriting the
+            // unchanged cells in between or moving right, anywhere else an absolute move
+            if (frame.term_row == r && c > frame.term_col)
+            {
+                int gap = at - (c - frame.term_col);
+                size_t gap_bytes = 0;
+                for (int skip = gap; skip < at; skip++)
+                    gap_bytes += strlen(frame.cells[skip].glyph);
+                int move_len = snprintf(move, sizeof(move), "\033[%dC", c - frame.term_col);
+                if (gap_bytes <= (size_t)move_len)
+                {
+                    for (int skip = gap; skip < at; skip++)
+                        emit(frame.cells[skip].glyph, strlen(frame.cells[skip].glyph));
+                }
+                else
+                    emit(move, move_len);
+            }
+            else if (frame.term_row != r || frame.term_col != c)
+            {
+                emit(move, snprintf(move, sizeof(move), "\033[%d;%dH", r, c));
+            }
+            emit(frame.cells[at].glyph, strlen(frame.cells[at].glyph));
+            frame.shown[at] = frame.cells[at];
+            frame.term_row = r;
+            frame.term_col = c + 1;
+        }
+    }
+    if (frame.term_row != frame.row || frame.term_col != frame.col)
+    {
+        emit(move, snprintf(move, sizeof(move), "\033[%d;%dH", frame.row, frame.col));
+        frame.term_row = frame.row;
+        frame.term_col = frame.col;
+    }
+
+    for (size_t done = 0; done < frame.out_len;)
+    {
+        ssize_t wrote = write(STDOUT_FILENO, frame.out + done, frame.out_len - done);
+        if (wrote == -1)
+            break;
+        done += wrote;
+    }
+}
+
+// The first deadline is one period from now
+void start_scheduler(scheduler *sched, int tdelay)
+{
+    memset(sched, 0, sizeof(*sched));
+    sched->period = tdelay * 1000L;
+
+    // the kernel may otherwise wake the sampler up to 50us after a deadline to batch timers
+    prctl(PR_SET_TIMERSLACK, 1L, 0L, 0L, 0L);
+    clock_gettime(CLOCK_MONOTONIC, &sched->deadline);
+    add_nanoseconds(&sched->deadline, sched->period);
+}
+
+// Sleep until the next deadline and record how late the wake up was
+void wait_deadline(scheduler *sched)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    // the sample overran its period, skip the deadlines already past instead of catching up in a burst
+    long behind = nanoseconds_between(&sched->deadline, &now);
+    if (behind >= 0)
+    {
+        long skip = behind / sched->period + 1;
+        sched->missed += skip;
+        add_nanoseconds(&sched->deadline, skip * sched->period);
+    }
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &sched->deadline, NULL) == EINTR)
+        ;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long late = nanoseconds_between(&sched->deadline, &now);
+    sched->waits++;
+    sched->late_sum += late;
+    if (late > sched->late_max)
+        sched->late_max = late;
+
+    add_nanoseconds(&sched->deadline, sched->period);
+}
+
+void add_nanoseconds(struct timespec *time, long nanoseconds)
+{
+    time->tv_sec += (time->tv_nsec + nanoseconds) / NANOSECONDS;
+    time->tv_nsec = (time->tv_nsec + nanoseconds) % NANOSECONDS;
+}
+
+long nanoseconds_between(const struct timespec *from, const struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) * NANOSECONDS + (to->tv_nsec - from->tv_nsec);
+}
+
+// Print on the line under the header how late the sampler woke up, the deadlines it missed and the samples
+// that found the ring full, then how long the newest sample waited to be drawn and the frames the renderer missed
+// the line is cut and padded to one less than the terminal width, a wrapped line would shift every row under it
+void display_schedule(const sample *latest, const scheduler *frames, double lag)
+{
+    char line[BUFFER];
+    int len = snprintf(line, sizeof(line), "Jitter %6.1f/%-6.1f us, missed %ld, ring full %ld, lag %6.1f ms, frames missed %ld",
+                       latest->late_avg, latest->late_max, latest->missed, latest->overruns, lag, frames->missed);
+    int width = terminal_width() - 1;
+    if (width > (int)sizeof(line) - 1)
+        width = sizeof(line) - 1;
+    if (len < width)
+        memset(line + len, ' ', width - len);
+    line[width] = '\0';
+    move_cursor_position(2, 1);
+    draw("%s", line);
+}
+
+// Columns of the terminal on stdout, SCREEN_COLS if it is not a terminal
+int terminal_width()
+{
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_col == 0)
+        return SCREEN_COLS;
+    return size.ws_col;
+}
+
+// Allocate the slots and the per-core usage of each, rows per sample are fixed from here on
+void open_ring(ring *queue, int rows)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->rows = rows;
+    queue->slots = (sample *)malloc(RING_SLOTS * sizeof(sample));
+    queue->usage = (float *)malloc((size_t)RING_SLOTS * rows * sizeof(float));
+    if (queue->slots == NULL || queue->usage == NULL)
+    {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+}
+
+void close_ring(ring *queue)
+{
+    free(queue->slots);
+    free(queue->usage);
+}
+
+// Sampler side: copy the sample into the next free slot and publish it, returns 0 if the ring is full
+int ring_push(ring *queue, const sample *entry, const float *usage)
+{
+    size_t head = queue->head;
+    if (head - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) == RING_SLOTS)
+        return 0;
+
+    size_t slot = head & (RING_SLOTS - 1);
+    queue->slots[slot] = *entry;
+    queue->slots[slot].rows = entry->rows < queue->rows ? entry->rows : queue->rows;
+    memcpy(queue->usage + slot * queue->rows, usage, queue->slots[slot].rows * sizeof(float));
+
+    // the slot is written before the renderer can see the new head
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// Renderer side: the oldest sample not drawn yet, or NULL, it stays valid until ring_pop
+const sample *ring_peek(ring *queue)
+{
+    if (queue->tail == __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE))
+        return NULL;
+    return &queue->slots[queue->tail & (RING_SLOTS - 1)];
+}
+
+const float *ring_usage(ring *queue, const sample *entry)
+{
+    return queue->usage + (entry - queue->slots) * queue->rows;
+}
+
+// Renderer side: give the peeked slot back to the sampler
+void ring_pop(ring *queue)
+{
+    __atomic_store_n(&queue->tail, queue->tail + 1, __ATOMIC_RELEASE);
+}
+
+// Sampler thread, one sample every tdelay on absolute deadlines, whatever the renderer is doing
+void *sample_loop(void *arg)
+{
+    sampling *job = (sampling *)arg;
+    start_scheduler(&job->sched, job->tdelay);
+    for (int taken = 0; taken < job->samples; taken++)
     {
-        printf("\033[%dA", -rows); // Move up by 'rows' lines
+        wait_deadline(&job->sched);
+        sample entry;
+        clock_gettime(CLOCK_MONOTONIC, &entry.taken);
+        entry.error = NULL;
+        if (get_cpu_usage(&job->smp) != 0)
+            entry.error = "/proc/stat not working\n";
+        else if (get_memory_usage(&entry.total_ram, &entry.used_ram) != 0)
+            entry.error = "sysinfo failed, cannot retrieve memory usage\n";
+        entry.rows = job->smp.rows;
+        entry.late_avg = job->sched.late_sum / job->sched.waits / 1000.0;
+        entry.late_max = job->sched.late_max / 1000.0;
+        entry.missed = job->sched.missed;
+        hand_over(job, &entry, job->smp.usage);
+
+        // the error goes to the renderer like any sample, nothing after it is sampled
+        if (entry.error != NULL)
+            break;
     }
-    else if (rows > 0)
+
+    // the renderer is behind, keep handing the samples left over until it caught up
+    while (job->pending_count > 0)
+    {
+        struct timespec pause = {0, FRAME_TDELAY * 1000L};
+        nanosleep(&pause, NULL);
+        flush_pending(job);
+    }
+    return NULL;
+}
+
+// Push a sample to the renderer, or keep it aside in order when the ring is full
+void hand_over(sampling *job, const sample *entry, const float *usage)
+{
+    flush_pending(job);
+    if (job->pending_count == 0)
     {
-        printf("\033[%dB", rows); // Move down by 'rows' lines
+        sample stamped = *entry;
+        stamped.overruns = job->overruns;
+        if (ring_push(&job->queue, &stamped, usage))
+            return;
     }
+    job->overruns++;
 
-    if (cols < 0)
+    // pending is a queue from pending_first, grown by moving it to the front of a bigger array
+    if (job->pending_first + job->pending_count == job->pending_cap)
     {
-        printf("\033[%dD", -cols); // Move left by 'cols' columns
+        size_t cap = job->pending_cap == 0 ? PENDING_START : job->pending_cap;
+        if (job->pending_count * 2 > cap)
+            cap *= 2;
+        int rows = job->queue.rows;
+        sample *pending = (sample *)malloc(cap * sizeof(sample));
+        float *pending_usage = (float *)malloc(cap * rows * sizeof(float));
+        if (pending == NULL || pending_usage == NULL)
+        {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        if (job->pending_count > 0)
+        {
+            memcpy(pending, job->pending + job->pending_first, job->pending_count * sizeof(sample));
+            memcpy(pending_usage, job->pending_usage + job->pending_first * rows, job->pending_count * rows * sizeof(float));
+        }
+        free(job->pending);
+        free(job->pending_usage);
+        job->pending = pending;
+        job->pending_usage = pending_usage;
+        job->pending_first = 0;
+        job->pending_cap = cap;
     }
-    else if (cols > 0)
+    size_t at = job->pending_first + job->pending_count++;
+    job->pending[at] = *entry;
+    job->pending[at].overruns = job->overruns;
+    job->pending[at].rows = entry->rows < job->queue.rows ? entry->rows : job->queue.rows;
+    memcpy(job->pending_usage + at * job->queue.rows, usage, job->pending[at].rows * sizeof(float));
+}
+
+// Move the samples kept aside into the ring, oldest first, as far as there is room
+void flush_pending(sampling *job)
+{
+    while (job->pending_count > 0)
     {
-        printf("\033[%dC", cols); // Move right by 'cols' columns
+        size_t at = job->pending_first;
+        if (!ring_push(&job->queue, &job->pending[at], job->pending_usage + at * job->queue.rows))
+            return;
+        job->pending_first++;
+        job->pending_count--;
     }
+    job->pending_first = 0;
 }
 
 // Draws the graph outline given the width and height
@@ -225,28 +1046,28 @@ void draw_graph_outline(int width, int height)
 {
     for (int row = height; row > 0; row--)
     {
-        printf("       |\n"); // Y-axis
+        draw("       |\n"); // Y-axis
     }
-    printf("       "); // empty spaces before horizotal line
+    draw("       "); // empty spaces before horizotal line
 
     int column = width;
     column = column + 1;
     for (; column > 0; column--)
     {
-        printf("─"); // X-axis
+        draw("─"); // X-axis
     }
-    printf("\n");
+    draw("\n");
 }
 
 void draw_memory_graph(int *samples)
 {
-    printf("v Memory       GB\n");
+    draw("v Memory       GB\n");
     draw_graph_outline(*samples, MEMORY_HEIGHT);
     shift_cursor(-13, 0);
-    printf("     GB");
+    draw("     GB");
     shift_cursor(12, -8);
-    printf("  0 GB");
-    printf("\033[F\n\n");
+    draw("  0 GB");
+    draw("\n"); // start of the row under the x-axis
 }
 
 void draw_cpu_graph(int *samples, int show_memory)
@@ -259,33 +1080,24 @@ void draw_cpu_graph(int *samples, int show_memory)
         shift_cursor(17, 0);
     }
 
-    printf("v CPU\n");
+    draw("v CPU\n");
     draw_graph_outline(*samples, CPU_HEIGHT);
     shift_cursor(-1, -8);
-    printf("    0%%");
+    draw("    0%%");
     shift_cursor(-10, -5);
-    printf("  100%%");
-    printf("\033[F\n\n");
+    draw("  100%%");
+    draw("\n"); // start of the row under the x-axis
 }
 
-void display_cpu_usage(int sample_num, int show_memory, long *prev_cpu_idle, long *prev_cpu_total)
+void display_cpu_usage(const float *usage, int sample_num, int show_memory)
 {
 
-    // Get new CPU usage values
-    long new_total = 0, new_idle = 0;
-    get_cpu_usage(&new_total, &new_idle);
+    // Row 0 is the aggregate cpu line, get_cpu_usage already computed it as a percentage
+    float cpu_usage = usage[0];
 
-    // Compute differences
-    float cpu_usage = calculate_cpu_usage(*prev_cpu_total, *prev_cpu_idle, new_total, new_idle); // returns as percentage
-
-    // Check for error
-    if (cpu_usage < 0)
-    {
-        clear_screen();
-        move_cursor_top();
-        printf("Error: CPU usage calculation failed\n");
-        exit(1);
-    }
+    // No tick counted since the monitor started, the column is left empty rather than drawn as idle
+    if (cpu_usage == NO_USAGE)
+        return;
 
     // Convert CPU usage to a value out of 10
     int cpu_usage_value = round(cpu_usage / 10);
@@ -295,66 +1107,91 @@ void display_cpu_usage(int sample_num, int show_memory, long *prev_cpu_idle, lon
     { // memory not shown
         move_cursor_position(14, 9);
         shift_cursor(-cpu_usage_value, sample_num);
-        printf(":");
+        draw(":");
         move_cursor_position(3, 8);
-        printf("%.2f%%", cpu_usage);
+        draw("%.2f%%", cpu_usage);
         move_cursor_position(15, 1);
     }
     else
     {
         move_cursor_position(29, 9); // memory shown
         shift_cursor(-cpu_usage_value, sample_num);
-        printf(":");
+        draw(":");
         move_cursor_position(18, 8);
-        printf("%.2f%%", cpu_usage);
+        draw("%.2f%%", cpu_usage);
         move_cursor_position(30, 1);
     }
-
-    // Update previous values for next sample
-    *prev_cpu_total = new_total;
-    *prev_cpu_idle = new_idle;
 }
 
-void get_cpu_usage(long *new_total, long *new_idle)
+// Read /proc/stat into the older sample and compute the usage of the aggregate cpu and every core against the newer one
+// returns 0 on success, it runs on the sampler thread so a failure is left to the renderer to show
+int get_cpu_usage(sampler *smp)
 {
-
-    // Open /proc/stat to read CPU usage
-    FILE *file = fopen("/proc/stat", "r");
-    if (!file)
+    int next = 1 - smp->current;
+    int rows = 0;
+    if (read_source(&smp->stat) > 0)
+        rows = parse_cpu_times(smp, &smp->times[next], smp->stat.buf);
+    if (rows == 0)
     {
-        clear_screen();
-        move_cursor_top();
-        printf("/proc/stat not working\n");
-        exit(1);
+        return -1;
     }
 
-    // Read the first line of /proc/stat
-    char buffer[BUFFER]; // Assume buffer is large enough
-    fgets(buffer, sizeof(buffer), file);
-    fclose(file);
-
-    // CPU usage always has same format with increasing values, store them in long varables
-    long user, nice, system, idle, iowait, irq, softirq, steal, guest, guest_nice;
-    user = nice = system = idle = iowait = irq = softirq = steal = guest = guest_nice = 0;
-    sscanf(buffer, "cpu %ld %ld %ld %ld %ld %ld %ld %ld %ld %ld",
-           &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal, &guest, &guest_nice);
-
-    // Total time is the sum of all times, including guest (virtual CPU) time
-    *new_total = user + nice + system + idle + iowait + irq + softirq + steal + guest + guest_nice;
+    // a row missing from either sample has no data, the older sample takes the newer times so its delta is 0 and it stays
+    // NO_USAGE rather than a core that just came online counting every tick since boot. The older sample is re-read next time anyway
+    cputimes *prev = &smp->times[smp->current], *now = &smp->times[next];
+    for (int i = 0; i < rows; i++)
+    {
+        if (!prev->present[i] || !now->present[i])
+        {
+            copy_cpu_row(prev, now, i);
+            smp->usage[i] = NO_USAGE;
+        }
+    }
+    calculate_cpu_usage(prev, now, smp->usage, rows);
+    smp->current = next;
+    smp->rows = rows;
+    return 0;
+}
 
-    // Idle time is the sum of idle and iowait
-    *new_idle = idle + iowait;
+// Show why the monitor stops in place of the graphs, renderer side only
+void exit_with_error(const char *message)
+{
+    clear_screen();
+    move_cursor_top();
+    draw("%s", message);
+    flush_screen();
+    exit(1);
 }
 
-float calculate_cpu_usage(long prev_total, long prev_idle, long new_total, long new_idle)
+// Busy percent of every row between two samples in one pass over the columns, usage holds the previous sample's
+// Total time is the sum of all times, including guest (virtual CPU) time, idle time is the sum of idle and iowait
+// deltas between two samples are ticks and fit an int, int math and no branches let the loop vectorize
+void calculate_cpu_usage(const cputimes *prev, const cputimes *now, float *usage, int rows)
 {
+    for (int i = 0; i < rows; i++)
+    {
+        int total = (int)((now->user[i] - prev->user[i]) + (now->nice[i] - prev->nice[i]) + (now->system[i] - prev->system[i]) +
+                          (now->idle[i] - prev->idle[i]) + (now->iowait[i] - prev->iowait[i]) + (now->irq[i] - prev->irq[i]) +
+                          (now->softirq[i] - prev->softirq[i]) + (now->steal[i] - prev->steal[i]) +
+                          (now->guest[i] - prev->guest[i]) + (now->guest_nice[i] - prev->guest_nice[i]));
+        int idle = (int)((now->idle[i] - prev->idle[i]) + (now->iowait[i] - prev->iowait[i]));
 
-    // Calculate the differences in total and aidle time
-    long total_diff = new_total - prev_total;
-    long idle_diff = new_idle - prev_idle;
+        // /proc/stat only moves every USER_HZ tick (10ms), a row with no tick since the last sample keeps its previous
+        // value, or NO_USAGE until its first tick, instead of showing idle. The divisor is clamped to 1 and the two values blended, both compile to selects
+        // rather than a branch
+        int ticked = total > 0;
+        int divisor = total > 0 ? total : 1;
+        float busy = 100.0f * (float)(total - idle) / (float)divisor;
+        usage[i] = (float)ticked * busy + (float)(1 - ticked) * usage[i];
+    }
+}
 
-    // Returns the CPU usage as a float percentage
-    return 100.0 * (1.0 - (((float)idle_diff / (float)total_diff)));
+// Open a file under the proc or sys root for reading
+FILE *open_root(const char *root, const char *path)
+{
+    char full_path[PATH_BUFFER];
+    snprintf(full_path, sizeof(full_path), "%s/%s", root, path);
+    return fopen(full_path, "r");
 }
 
 void getCpuInfo(int *num_cores, float *max_frequency)
@@ -363,12 +1200,13 @@ void getCpuInfo(int *num_cores, float *max_frequency)
     char line[BUFFER];
 
     // Check the number of cores
-    fp = fopen("/proc/cpuinfo", "r");
+    fp = open_root(proc_root, "cpuinfo");
     if (fp == NULL)
     {
         clear_screen();
         move_cursor_top();
-        printf("Error: /proc/cpuinfo\n");
+        draw("Error: /proc/cpuinfo\n");
+        flush_screen();
         exit(1);
     }
 
@@ -383,12 +1221,13 @@ void getCpuInfo(int *num_cores, float *max_frequency)
     fclose(fp);
 
     // Get the max frequency for the first core (Assume the same for all cores)
-    fp = fopen("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", "r");
+    fp = open_root(sys_root, "devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq");
     if (fp == NULL)
     {
         clear_screen();
         move_cursor_top();
-        printf("Error: Max freq of cores cannot be retrieved\n");
+        draw("Error: Max freq of cores cannot be retrieved\n");
+        flush_screen();
         exit(1);
     }
 
@@ -397,15 +1236,29 @@ void getCpuInfo(int *num_cores, float *max_frequency)
     fclose(fp);
 }
 
-void display_cores()
+// Row the cursor is left on by the graphs shown, the core info goes under it
+int graphs_bottom(int show_memory, int show_cpu)
+{
+    if (show_memory && show_cpu)
+        return 30;
+    if (show_cpu)
+        return 15;
+    if (show_memory)
+        return 17;
+    return 3; // only the header line
+}
+
+// Draw the core info from row on, returns the number of core boxes drawn
+int display_cores(int row)
 {
     int num_cores = 0;
     float max_frequency = 0;
     getCpuInfo(&num_cores, &max_frequency);
-    printf("\nv Number of Cores: %d @ %.2f GHz\n", num_cores, max_frequency / 1000000.0); // max frequency convert toGHz
+    move_cursor_position(row, 1);
+    draw("\nv Number of Cores: %d @ %.2f GHz\n", num_cores, max_frequency / 1000000.0); // max frequency convert toGHz
 
     // Creates new lines to prevent overlapping with the previous graphs
-    printf("\n\n\n");
+    draw("\n\n\n");
     shift_cursor(-3, 0);
 
     // Print the squares for each core
@@ -414,26 +1267,41 @@ void display_cores()
         printsquare();
 
         // Print a newline after every 4 outputs while prevent overlapping with the previous graphs
-        if (i % 4 == 0)
+        if (i % CORES_PER_ROW == 0)
         {
-            printf("\n\n\n\n\n\n");
+            draw("\n\n\n\n\n\n");
             shift_cursor(-3, 0);
         }
     }
 
     // Print a final newline if the last line has less than 4 outputs
-    if (num_cores % 4 != 0)
+    if (num_cores % CORES_PER_ROW != 0)
+    {
+        draw("\n\n\n");
+    }
+    return num_cores;
+}
+
+// Write each core's load inside its box, the boxes start 2 rows under row and are 3 rows high and 7 columns apart
+void display_core_usage(const float *usage, int rows, int row, int num_cores)
+{
+    int shown = num_cores < rows - 1 ? num_cores : rows - 1;
+    for (int core = 0; core < shown; core++)
     {
-        printf("\n\n\n");
+        move_cursor_position(row + 3 + core / CORES_PER_ROW * 3, 2 + core % CORES_PER_ROW * 7);
+        if (usage[core + 1] == NO_USAGE)
+            draw("  -");
+        else
+            draw("%3.0f", usage[core + 1]);
     }
 }
 
 void printsquare()
 {
-    printf("+---+ ");
+    draw("+---+ ");
     shift_cursor(1, -6);
-    printf("|   | ");
+    draw("|   | ");
     shift_cursor(1, -6);
-    printf("+---+ ");
+    draw("+---+ ");
     shift_cursor(-2, 1);
 }
\ No newline at end of file
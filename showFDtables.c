@@ -1,3 +1,4 @@
+#define _GNU_SOURCE // syscall() for getdents64, statx
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,37 +11,586 @@
 #include <pwd.h>
 #include <grp.h>
 #include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <time.h>
+#include <limits.h>
+#include <regex.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/inet_diag.h>
+#include <linux/unix_diag.h>
+#include <linux/io_uring.h>
 
+#define PATH_BUFFER 4096 // bytes for a path under the proc root
+#define PID_BATCH 64 // most pids handed to a worker at a time in parallel scan, fewer when there are few pids so every worker gets some
+#define TABLE_START 256 // starting capacity of a fdtable
+#define COUNT_START 256 // starting slots of a pidcountmap, always a power of 2
+#define INTERN_START 256 // starting slots of an internstruct, always a power of 2
+#define ARENA_CHUNK 65536 // bytes per arena chunk for interned strings
+#define DENTS_BUFFER 32768 // bytes of fd directory entries read per getdents64 call
+#define DENTS_MAX (DENTS_BUFFER / 24) // most entries one getdents64 call can return, 24 bytes is the smallest entry
+#define ENGINE_SYNC 0 // --engine, how fds are stat'ed
+#define ENGINE_URING 1
+#define URING_DEPTH 128 // statx requests a scan thread keeps in flight with --engine=uring
+#define CACHE_START 1024 // starting slots of an inodecache, always a power of 2
+#define CACHE_MAX 65536 // resolved files an inodecache holds before it is emptied, keeps memory bounded
+#define TYPE_FILE 1 // fd type bits for --type
+#define TYPE_SOCKET 2
+#define TYPE_PIPE 4
+#define TYPE_ANON 8
+#define SNAP_MAGIC "FDSNAP\0\0" // first 8 bytes of a --output_binary snapshot
+#define SNAP_VERSION 1 // bumped whenever the snapshot layout changes
+#define SNAP_BLOCK 4096 // column values gathered per fwrite when writing a snapshot
+#define SNAP_ALIGN(off) (((off) + 7) & ~(uint64_t)7) // sections of a snapshot start 8 byte aligned
+#define ARCH_MAGIC "FDARCH\0\0" // first 8 bytes of an --archive file
+#define ARCH_VERSION 2 // bumped whenever the archive layout changes
+#define ARCH_TAG "FDRC" // first 4 bytes of an archive record holding a delta against the record before it
+#define ARCH_KEYTAG "FDKF" // first 4 bytes of an archive keyframe, a record holding the whole table and its own path dictionary
+#define ARCH_KEYFRAME 64 // records from one keyframe to the next, an append or a --load decodes at most this many
+#define LEAK_SAMPLES 32 // fd counts kept per pid by --leaks
+#define LEAK_MIN_SAMPLES 5 // samples a pid needs before it can be reported as leaking
+#define LEAK_ALPHA 0.3 // weight of the newest growth rate in the --leaks moving average
+#define GROUP_UID 0 // --by view kinds
+#define GROUP_CGROUP 1
+#define GROUP_EXE 2
+#define GROUP_VIEWS 3 // most --by views at once
+#define OUT_BUFFER 1048576 // bytes an outwriter collects before each write, --stream also writes after every pid
+#define FORMAT_CSV 5 // table types of --format, printed in place of the composite table
+#define FORMAT_JSON 6
+#define FORMAT_NDJSON 7
+#define NET_BUFFER 262144 // starting bytes of the buffer a /proc/net table is read into, doubles as needed
+#define NET_READ 65536 // least free space asked of each read of a /proc/net table
+#define PROTO_TCP 0 // sockinfo protocols, in the order their /proc/net tables are read
+#define PROTO_TCP6 1
+#define PROTO_UDP 2
+#define PROTO_UDP6 3
+#define PROTO_UNIX 4
+#define STATS_LIST 0 // --stats phases, each timed with the monotonic clock
+#define STATS_FILTER 1
+#define STATS_OPEN 2
+#define STATS_GETDENTS 3
+#define STATS_STAT 4
+#define STATS_READLINK 5
+#define STATS_NODE 6
+#define STATS_MERGE 7
+#define STATS_SUMMARY 8
+#define STATS_OUTPUT 9
+#define STATS_PHASES 10
 
-//Linkedlist struct for pid, fd, filename, inode 
+
+//Directory entry layout returned by getdents64
+typedef struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+} linux_dirent64;
+
+//Row struct for pid, fd, inode, and id of the filename in the table's intern table
 typedef struct pidstruct {
     int node_pid;
     int fd;
-    char file_name[1000];
-    int inode;
-    struct pidstruct* next;
+    long inode;
+    int path_id;
 } pidstruct;
 
-//Linkedlist struct for summary and threshold table
+//Arena chunk that interned strings are packed into, chunks never move once allocated
+typedef struct arenachunk {
+    struct arenachunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+} arenachunk;
+
+//Intern table, each distinct string is stored once and referred to by id
+typedef struct internstruct {
+    char **strs;
+    unsigned int *hashes;
+    int nstrs;
+    int *slots;
+    int nslots;
+    arenachunk *arena;
+} internstruct;
+
+//Socket or pipe an fd resolved to, keyed by mount and inode, name_id is the cached filename id+1 (0 = empty)
+typedef struct inodekey {
+    uint64_t mnt;
+    uint64_t dev;
+    uint64_t ino;
+    int name_id;
+} inodekey;
+
+//io_uring of one scan thread, the mapped submission and completion rings plus a statx buffer and result per in-flight slot
+typedef struct uring {
+    int fd;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map;
+    void *cq_map;
+    size_t sq_size;
+    size_t cq_size;
+    size_t sqes_size;
+    unsigned pending;
+    struct statx stx[URING_DEPTH];
+    int res[URING_DEPTH];
+    int done[URING_DEPTH];
+} uring;
+
+//Per scan cache of sockets and pipes, so every fd sharing one only needs a single readlink
+typedef struct inodecache {
+    inodekey *slots;
+    int nslots;
+    int nused;
+    int no_statx;
+    uring *ring;
+    int no_uring;
+    internstruct names;
+} inodecache;
+
+//Stat key of one --watch row, path_id is the row's filename in the same table
+typedef struct watchkey {
+    int node_pid;
+    int fd;
+    long inode;
+    int path_id;
+    uint64_t mnt;
+    uint64_t dev;
+    uint64_t ino;
+} watchkey;
+
+//Growable array of rows in scan order, with the filenames they refer to
+//a keyed table (--watch) also keeps the stat key of every stat'ed row, at most one per row so keys share the row capacity
+typedef struct fdtable {
+    pidstruct *rows;
+    size_t count;
+    size_t cap;
+    internstruct paths;
+    int keyed;
+    watchkey *keys;
+    size_t nkeys;
+} fdtable;
+
+//Count of fds for one pid, for summary and threshold table
 typedef struct pidcountstruct {
     int node_pid;
     int count;
-    struct pidcountstruct *next;
 } pidcountstruct;
 
+//Counts in first seen order, with open addressing hash slots (index+1, 0 = empty) to find a pid
+typedef struct pidcountmap {
+    pidcountstruct *counts;
+    int ncounts;
+    int *slots;
+    int nslots;
+} pidcountmap;
+
+//Min heap of the k pids with the most fds seen so far, rows of the pid being counted are tallied in cur_count
+typedef struct topheap {
+    pidcountstruct *heap;
+    int k;
+    int n;
+    int types;
+    char *label;
+    int cur_pid;
+    int cur_count;
+} topheap;
+
+//One --by view, fd and process counts per group name id, cur_id is the group of the pid being counted
+typedef struct aggview {
+    int kind;
+    internstruct keys;
+    long *fds;
+    int *procs;
+    int cap;
+    int cur_pid;
+    int cur_id;
+} aggview;
+
+//One group of a --by view as it is printed, id is its name id in the view's keys
+typedef struct groupcount {
+    int id;
+    int procs;
+    long fds;
+} groupcount;
+
+//Views selected with --by, in the order given
+typedef struct groupby {
+    aggview views[GROUP_VIEWS];
+    int nviews;
+} groupby;
+
+//Index from type and inode and from filename id to the rows holding them, chains of row indices ending in -1
+typedef struct holderindex {
+    int *first_by_path;
+    int *next_by_path;
+    int *inode_slots;
+    int ninode_slots;
+    int *next_by_inode;
+} holderindex;
+
+//Row filters, each one is checked as early in the scan as the value it needs is known
+typedef struct filterstruct {
+    int uid;
+    char *comm;
+    int types;
+    char *path_prefix;
+    int fd_min;
+    int fd_max;
+} filterstruct;
+
+//Fd count of one pid in a --watch scan and how much it changed since the last scan
+typedef struct piddelta {
+    int node_pid;
+    int count;
+    int delta;
+} piddelta;
+
+//Ring of the last LEAK_SAMPLES fd counts of one pid, head is the next slot to write, ewma in fds per second
+//start is the process start time, a pid reused by a new process gets a new history
+typedef struct leaktrack {
+    int node_pid;
+    long long start;
+    int seen;
+    int nsamples;
+    int head;
+    int counts[LEAK_SAMPLES];
+    double ewma;
+    long limit;
+} leaktrack;
+
+//Histories of the live pids, with open addressing hash slots (index+1, 0 = empty) to find a pid
+typedef struct leakmap {
+    leaktrack *tracks;
+    int ntracks;
+    int cap;
+    int *slots;
+    int nslots;
+} leakmap;
+
+//Header of a --output_binary snapshot, native byte order, offsets are from the start of the file
+//Sections: pid, fd, inode and path id columns (nrows each), then string offsets, string hashes and the null terminated strings
+typedef struct snapheader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int64_t taken;
+    char host[64];
+    uint64_t nrows;
+    uint64_t nstrs;
+    uint64_t pid_off;
+    uint64_t fd_off;
+    uint64_t inode_off;
+    uint64_t path_off;
+    uint64_t stroff_off;
+    uint64_t hash_off;
+    uint64_t str_off;
+    uint64_t str_size;
+} snapheader;
+
+//Header of an --archive file, records of one snapshot each follow it, in the order they were taken
+//keyframe is rewritten after each keyframe is on disk, so replaying only has to start there
+typedef struct archheader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    char host[64];
+    uint64_t keyframe;       // offset of the last keyframe, 0 before the first one
+    uint64_t keyframe_index; // records before it
+} archheader;
+
+//Header of one archive record, the table at taken as a delta against the record before it, or against no rows and an empty dictionary for a keyframe
+//Followed by size bytes of varints: nstrs new paths (length, bytes) added to the path dictionary, nremoved pid/fd keys, then nadded rows
+//Keys are sorted by pid then fd, pid is a delta from the last key and fd a delta when the pid repeats; inode and path id are zigzag deltas
+typedef struct archrecord {
+    char tag[4];
+    uint32_t nstrs;
+    int64_t taken;
+    uint64_t size;
+    uint64_t nrows;
+    uint64_t nremoved;
+    uint64_t nadded;
+} archrecord;
+
+//Growable byte buffer an archive record is encoded into
+typedef struct archbuf {
+    unsigned char *buf;
+    size_t used;
+    size_t cap;
+} archbuf;
+
+//Socket from a /proc/net table, addresses in network order, path is an offset into the unix buffer (-1 = none)
+typedef struct sockinfo {
+    unsigned long inode;
+    unsigned char local[16];
+    unsigned char remote[16];
+    unsigned short local_port;
+    unsigned short remote_port;
+    unsigned short unix_type;
+    unsigned char proto;
+    unsigned char state;
+    long path;
+} sockinfo;
+
+//Sockets of every /proc/net table read once per scan, with open addressing hash slots (index+1, 0 = empty) by inode
+typedef struct netinfo {
+    sockinfo *socks;
+    int nsocks;
+    int cap;
+    int *slots;
+    int nslots;
+    char *buf;
+    size_t size;
+    char *unix_buf;
+    size_t unix_size;
+} netinfo;
+
+//Buffered writer, rows are formatted straight into buf and written out with one write per OUT_BUFFER bytes
+//--stream flushes it after each pid as well (loop_pid), so a full buffer never delays the first rows
+typedef struct outwriter {
+    int fd;
+    char *buf;
+    size_t used;
+    int rows;
+    int failed;
+} outwriter;
+
+//Where loop_fd sends each row, appended to a table or in --stream mode printed and counted as soon as it is found
+typedef struct rowsink {
+    fdtable *table;
+    inodecache *cache;
+    filterstruct *filter;
+    int stream;
+    int show[8];
+    outwriter *out;
+    pidcountmap *countmap;
+    topheap *top;
+    groupby *by;
+    netinfo *net;
+    outwriter *txt;
+    fdtable *snap;
+    fdtable *prev;
+} rowsink;
+
+#ifdef FD_STATS
+//--stats timers and counters of one thread, workers add theirs to a shared total when they finish
+typedef struct scanstats {
+    uint64_t ns[STATS_PHASES];
+    long calls[STATS_PHASES];
+    long pids;
+    long denied;
+    long vanished;
+    long fds;
+    long cache_hits;
+    long writes;
+} scanstats;
+
+// time a phase, count an event, or sort a failed open/readlink into denied and vanished; all of it compiles out without FD_STATS
+#define STATS_START(t) uint64_t t = stats_on ? stats_now() : 0
+#define STATS_STOP(phase, t) do {if (stats_on) {stats.ns[phase] += stats_now() - (t); stats.calls[phase]++;}} while (0)
+#define STATS_COUNT(counter) do {if (stats_on) {stats.counter++;}} while (0)
+#define STATS_FAILED() do {if (stats_on) {if (errno == EACCES || errno == EPERM) {stats.denied++;} else if (errno == ENOENT || errno == ESRCH) {stats.vanished++;}}} while (0)
+#define STATS_PRINT(t) do {if (stats_on) {print_stats(stats_now() - (t));}} while (0)
+#else
+#define STATS_START(t)
+#define STATS_STOP(phase, t)
+#define STATS_COUNT(counter)
+#define STATS_FAILED()
+#define STATS_PRINT(t)
+#endif
+
+//Pid selectors, a pid is scanned if any range (lo, hi pairs), name or regex matches its comm, every pid when there are none
+//children adds the whole process subtree of every selected pid
+typedef struct pidselect {
+    int *ranges;
+    int nranges;
+    char **names;
+    int nnames;
+    regex_t *regexes;
+    int nregexes;
+    int children;
+} pidselect;
 
-void parse_arguments(int argc, char *argv[], int *per_process, int *systemWide, int *Vnodes, int *composite, int *summary, int *threshold, int *pid, int* output_txt, int* output_b);
+//Parent of one pid, sorted by parent so the children of a pid are one run
+typedef struct pidparent {
+    int ppid;
+    int pid;
+} pidparent;
+
+//Shared work queue for parallel scan, each batch of pids gets its own table
+typedef struct scanjob {
+    int *pids;
+    int npids;
+    int batch;
+    int nbatches;
+    int next_batch;
+    filterstruct *filter;
+    fdtable *prev;
+    fdtable *batch_tables;
+    pthread_mutex_t lock;
+} scanjob;
+
+
+void parse_arguments(int argc, char *argv[], int *per_process, int *systemWide, int *Vnodes, int *composite, int *format, int *summary, int *threshold, pidselect *sel, int* output_txt, int* output_b, int *jobs, int *stream, int *sockets, char **holders, char **load, char **archive, char **at, double *watch, double *leaks, topheap *top, groupby *by, filterstruct *filter);
+int parse_types(char *types);
 void print_header(int table_type);
-void loop_pid(int pid, pidstruct** head);
-void loop_fd(int pid, pidstruct** head);
-void create_node(int pid, char *fd, char *file_name, ino_t inode, pidstruct** head);
-void print_table(pidstruct* head, int table_type);
-void summary_count(int pid, pidcountstruct** counthead);
-void summary_list(pidstruct* head, pidcountstruct** counthead);
-void print_summary(pidcountstruct* counthead);
-void print_threshold(pidcountstruct* head, int threshold);
-void output_text(pidstruct* head);
-void output_binary(pidstruct* head);
+void print_footer(int table_type);
+void loop_pid(pidselect* sel, rowsink* sink, int jobs);
+void parallel_scan(int *pids, int npids, rowsink* sink, int jobs);
+void *scan_worker(void *arg);
+void loop_fd(int pid, rowsink* sink);
+int filter_pid(filterstruct* filter, int pid);
+int fd_type(int stat_return, mode_t mode, const char *file_name);
+int filter_path(filterstruct* filter, const char *file_name);
+void emit_row(rowsink* sink, int pid, char *fd, const char *file_name, long inode);
+int resolve_fd(rowsink* sink, int pid, int dirfd, char *fd, int stat_return, inodekey* key, mode_t mode);
+int stat_fd(inodecache* cache, int dirfd, const char *fd, inodekey* key, mode_t* mode);
+void statx_key(struct statx* stx, inodekey* key, mode_t* mode);
+int uring_scan(rowsink* sink, int pid, int dirfd, char **fds, int nfds);
+void uring_wait(uring* ring, int wait);
+uring *uring_open(void);
+void uring_close(uring* ring);
+inodekey *cache_find(inodecache* cache, inodekey* key);
+void cache_grow(inodecache* cache);
+void cache_free(inodecache* cache);
+long parse_link_inode(const char *file_name);
+void stream_scan(pidselect* sel, int per_process, int systemWide, int Vnodes, int composite, int format, int summary, int threshold, int output_txt, int output_b, netinfo *net, topheap *top, groupby *by, filterstruct *filter);
+void watch_scan(pidselect* sel, filterstruct *filter, double interval, const char *archive, int jobs);
+int row_cmp(const void *a, const void *b);
+int key_cmp(const void *a, const void *b);
+void keep_key(rowsink* sink, inodekey* key);
+watchkey *key_find(fdtable* table, int pid, int fd);
+void watch_diff(fdtable* prev, fdtable* cur, int scan);
+void watch_header(int scan);
+void leak_scan(pidselect* sel, filterstruct *filter, double interval);
+int list_pids(int **pids);
+int select_pids(pidselect* sel, int **pids);
+int select_match(pidselect* sel, int pid);
+int select_children(int *all, int nall, int **pids, int npids);
+int read_ppid(int pid);
+int pid_cmp(const void *a, const void *b);
+int parent_cmp(const void *a, const void *b);
+void parse_selector(char *arg, pidselect* sel);
+void select_free(pidselect* sel);
+int count_fds(int pid);
+leaktrack *leak_find(leakmap* leaks, int pid, long long start);
+long long read_start(int pid);
+void leak_rehash(leakmap* leaks);
+void leak_sample(leaktrack* track, int count, int round, double dt);
+void leak_compact(leakmap* leaks, int round);
+int leak_steady(leaktrack* track);
+long read_nofile(int pid);
+void leak_report(leakmap* leaks, int round);
+int read_comm(int pid, char *comm, size_t size);
+void create_node(int pid, char *fd, const char *file_name, long inode, fdtable* table);
+void table_reserve(fdtable* table, size_t need);
+void table_free(fdtable* table);
+const char *row_path(fdtable* table, pidstruct* row);
+int intern(internstruct* paths, const char *str);
+int intern_find(internstruct* paths, const char *str);
+void intern_grow(internstruct* paths);
+char *arena_copy(internstruct* paths, const char *str, size_t len);
+void intern_free(internstruct* paths);
+void print_table(fdtable* table, int table_type, netinfo* net);
+void print_row(outwriter* out, int table_type, int pid, int fd, const char *file_name, long inode, netinfo* net);
+void out_init(outwriter* out, int fd);
+void out_bytes(outwriter* out, const char *str, size_t len);
+void out_str(outwriter* out, const char *str);
+void out_long(outwriter* out, long val);
+void out_csv(outwriter* out, const char *str);
+void out_json(outwriter* out, const char *str);
+size_t utf8_len(const unsigned char *pos);
+void out_flush(outwriter* out);
+void out_free(outwriter* out);
+void summary_count(int pid, pidcountmap* countmap);
+void summary_list(fdtable* table, pidcountmap* countmap);
+void countmap_grow(pidcountmap* countmap);
+void countmap_free(pidcountmap* countmap);
+void print_summary(pidcountmap* countmap);
+void print_threshold(pidcountmap* countmap, int threshold);
+void top_count(topheap* top, int pid, const char *file_name);
+void top_push(topheap* top, int pid, int count);
+int top_cmp(const void *a, const void *b);
+void print_top(topheap* top, int live);
+void group_count(groupby* by, int pid);
+void group_key(int kind, int pid, char *key, size_t size);
+void group_reserve(aggview* view);
+void print_groups(groupby* by);
+int group_cmp(const void *a, const void *b);
+void groupby_free(groupby* by);
+int parse_groups(char *groups, groupby* by);
+void output_text(fdtable* table);
+int output_open(outwriter* out, const char *file_name);
+void output_row(outwriter* out, int pid, int fd, const char *file_name, long inode);
+void output_close(outwriter* out);
+void output_binary(fdtable* table);
+uint64_t snapshot_pad(FILE *fptr, uint64_t pos, uint64_t off);
+void snapshot_load(const char *file_name, fdtable* table, void **map, size_t *map_size);
+int snapshot_fits(size_t size, uint64_t off, uint64_t len);
+void archive_append(const char *file_name, fdtable* table);
+int archive_load(const char *file_name, const char *at, fdtable* table);
+size_t archive_replay(const char *base, size_t size, size_t from, int64_t at, fdtable* state, int *records, int64_t *taken);
+size_t archive_start(const char *base, size_t size, int64_t at, int *index);
+void archive_apply(fdtable* state, const unsigned char *pos, archrecord* rec);
+int archive_key(const unsigned char **pos, const unsigned char *end, pidstruct* last, pidstruct* row, int full);
+void archive_put_key(archbuf* buf, pidstruct* last, pidstruct* row, int full);
+int get_varint(const unsigned char **pos, const unsigned char *end, uint64_t *val);
+void put_varint(archbuf* buf, uint64_t val);
+void archbuf_put(archbuf* buf, const void *data, size_t len);
+int64_t parse_time(const char *str);
+void holders_build(fdtable* table, holderindex* index);
+int holders_by_inode(fdtable* table, holderindex* index, int type, long inode);
+void holders_free(holderindex* index);
+void print_holders(fdtable* table, holderindex* index, const char *query, netinfo* net, int live);
+const char *pipe_end(const char *file_name, int pid, int fd);
+long unix_peer(long inode);
+void net_load(netinfo* net);
+size_t read_whole(const char *file_path, char **buf, size_t *size);
+char *skip_fields(char *pos, int count);
+unsigned long scan_hex(char **pos);
+unsigned long scan_dec(char **pos);
+int scan_addr(char **pos, unsigned char *addr, unsigned short *port, int words);
+void net_parse_inet(netinfo* net, char *line, int proto);
+void net_parse_unix(netinfo* net, char *line);
+void net_add(netinfo* net, sockinfo* sock);
+void net_slot_set(netinfo* net, int i);
+sockinfo *net_find(netinfo* net, long inode);
+const char *sock_desc(netinfo* net, const char *file_name, long inode, char *desc, size_t size);
+void net_free(netinfo* net);
+#ifdef FD_STATS
+uint64_t stats_now(void);
+void stats_add(scanstats* total, scanstats* part);
+void print_stats(uint64_t wall);
+#endif
+
+//Where procfs is read from, --proc-root points it at a copy or a synthetic tree
+static const char *proc_root = "/proc";
+
+//How fds are stat'ed, --engine=uring queues them through io_uring
+static int stat_engine = ENGINE_SYNC;
+
+#ifdef FD_STATS
+//--stats state, every scan thread counts into its own copy
+static int stats_on = 0;
+static __thread scanstats stats;
+static scanstats stats_total;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 
 int main(int argc, char *argv[]){
@@ -50,457 +600,2792 @@ int main(int argc, char *argv[]){
     ///_|> returning: return 0 after program ends
 
     // Process arguments
-    int per_process, systemWide, Vnodes, composite, summary, threshold, pid, output_txt, output_b;
-    per_process = 0; systemWide = 0; Vnodes = 0; composite = 0; summary = 0; threshold = -1; pid = -1; output_txt = 0; output_b = 0;
-    parse_arguments(argc, argv, &per_process, &systemWide, &Vnodes, &composite, &summary, &threshold, &pid, &output_txt, &output_b);
+    int per_process, systemWide, Vnodes, composite, format, summary, threshold, output_txt, output_b, jobs, stream, sockets;
+    per_process = 0; systemWide = 0; Vnodes = 0; composite = 0; format = 4; summary = 0; threshold = -1; output_txt = 0; output_b = 0; jobs = 1; stream = 0; sockets = 0;
+    char *holders = NULL;
+    char *load = NULL;
+    char *archive = NULL;
+    char *at = NULL;
+    double watch = 0;
+    double leaks = 0;
+    filterstruct filter = {-1, NULL, 0, NULL, 0, -1};
+    topheap top = {NULL, 0, 0, 0, NULL, -1, 0};
+    groupby by;
+    memset(&by, 0, sizeof(by));
+    pidselect sel;
+    memset(&sel, 0, sizeof(sel));
+    parse_arguments(argc, argv, &per_process, &systemWide, &Vnodes, &composite, &format, &summary, &threshold, &sel, &output_txt, &output_b, &jobs, &stream, &sockets, &holders, &load, &archive, &at, &watch, &leaks, &top, &by, &filter);
+    STATS_START(run_start);
+
+    // the only memory --top takes, whatever the number of pids
+    if (top.k > 0) {
+        top.heap = (pidcountstruct *)malloc(top.k * sizeof(pidcountstruct));
+        if (top.heap == NULL) {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+    }
+
+    // owners are read from /proc, which no longer matches a snapshot's pids
+    if (by.nviews > 0 && load != NULL) {
+        fprintf(stderr, "--by needs a live scan\n");
+        exit(1);
+    }
 
-    // If there is specific pid in argument, check if it is valid
-    if (pid != -1){
+    // io_uring can be missing or disabled, scan with plain statx then
+    if (stat_engine == ENGINE_URING) {
+        uring *probe = uring_open();
+        if (probe == NULL) {
+            fprintf(stderr, "io_uring not available, using synchronous statx\n");
+            stat_engine = ENGINE_SYNC;
+        }
+        uring_close(probe);
+    }
+
+    // --at picks a snapshot out of an archive
+    if (at != NULL && load == NULL) {
+        fprintf(stderr, "--at needs --load of an archive\n");
+        exit(1);
+    }
+
+    // If there are specific pids in argument, check if they are valid, ranges only cover the pids that exist
+    for (int r = 0; r < sel.nranges && load == NULL; r++){
+        if (sel.ranges[2 * r] != sel.ranges[2 * r + 1]) {continue;}
         DIR *pdir;
-        char file_path[1000]; 
-        sprintf(file_path, "/proc/%d/fd", pid);
+        char file_path[PATH_BUFFER]; 
+        snprintf(file_path, sizeof(file_path), "%s/%d/fd", proc_root, sel.ranges[2 * r]);
         pdir = opendir(file_path);
         if (pdir == NULL) {
             fprintf(stderr, "pid non valid\n");
-            closedir(pdir);
             exit(1);
         }
         closedir(pdir);
     }
 
-    // Generate linked list of all info
-    pidstruct* head = NULL;
-    loop_pid(pid, &head);
+    // --leaks only counts fds, there is no table to archive
+    if (leaks > 0 && archive != NULL) {
+        fprintf(stderr, "--archive needs the fd table, not --leaks\n");
+        exit(1);
+    }
+
+    // sample fd counts until interrupted, reporting steady growth
+    if (leaks > 0 && load == NULL) {
+        leak_scan(&sel, &filter, leaks);
+        return 0;
+    }
+
+    // rescan until interrupted, printing what changed and archiving every scan
+    if (watch > 0 && load == NULL) {
+        watch_scan(&sel, &filter, watch, archive, jobs);
+        return 0;
+    }
+
+    // socket tables are read once, before the scan, so the fds found are in them
+    netinfo net;
+    memset(&net, 0, sizeof(net));
+    netinfo *netp = NULL;
+    if (sockets == 1 && load == NULL) {
+        net_load(&net);
+        netp = &net;
+    }
+
+    // Print rows as they are found instead of building the table, holders and archive need the whole table
+    if (stream == 1 && holders == NULL && archive == NULL && load == NULL) {
+        stream_scan(&sel, per_process, systemWide, Vnodes, composite, format, summary, threshold, output_txt, output_b, netp, top.k > 0 ? &top : NULL, by.nviews > 0 ? &by : NULL, &filter);
+        net_free(&net);
+        free(top.heap);
+        groupby_free(&by);
+        select_free(&sel);
+        STATS_PRINT(run_start);
+        return 0;
+    }
+
+    // Generate table of all info, or read it from a snapshot or an archive
+    fdtable table;
+    memset(&table, 0, sizeof(table));
+    void *snap_map = NULL;
+    size_t snap_size = 0;
+    if (load != NULL) {
+        if (archive_load(load, at, &table) == 0) {
+            if (at != NULL) {
+                fprintf(stderr, "--at needs --load of an archive\n");
+                exit(1);
+            }
+            snapshot_load(load, &table, &snap_map, &snap_size);
+        }
+    } else {
+        inodecache cache;
+        memset(&cache, 0, sizeof(cache));
+        rowsink sink;
+        memset(&sink, 0, sizeof(sink));
+        sink.table = &table;
+        sink.cache = &cache;
+        sink.filter = &filter;
+        loop_pid(&sel, &sink, jobs);
+        cache_free(&cache);
+    }
 
     //print tables 
-    if (per_process == 1) {print_table(head, 1);}
-    if (systemWide == 1) {print_table(head,2);}
-    if (Vnodes == 1) {print_table(head, 3);}
-    if (composite == 1) {print_table(head, 4);}
-    if (output_txt == 1) {output_text(head);}
-    if (output_b == 1) {output_binary(head);}
+    STATS_START(output_start);
+    if (per_process == 1) {print_table(&table, 1, netp);}
+    if (systemWide == 1) {print_table(&table,2, netp);}
+    if (Vnodes == 1) {print_table(&table, 3, netp);}
+    if (composite == 1) {print_table(&table, format, netp);}
+    if (output_txt == 1) {output_text(&table);}
+    if (output_b == 1) {output_binary(&table);}
+    if (archive != NULL) {archive_append(archive, &table);}
+    STATS_STOP(STATS_OUTPUT, output_start);
 
     if (summary == 1 || threshold != -1){
 
-        // create linked list that counts occurances of pid for each fd
-        pidcountstruct* counthead = NULL;
-        summary_list(head, &counthead);
+        // create map that counts occurances of pid for each fd
+        STATS_START(summary_start);
+        pidcountmap countmap = {NULL, 0, NULL, 0};
+        summary_list(&table, &countmap);
 
         // print summary and threshold graphs
-        if (summary == 1){print_summary(counthead);}
-        if (threshold != -1) {print_threshold(counthead, threshold);}
+        if (summary == 1){print_summary(&countmap);}
+        if (threshold != -1) {print_threshold(&countmap, threshold);}
         
-        // free linkedlist
-        pidcountstruct* temp;
-        while (counthead != NULL) {
-            temp = counthead;
-            counthead = counthead->next;
-            free(temp);
+        countmap_free(&countmap);
+        STATS_STOP(STATS_SUMMARY, summary_start);
+    }
+
+    // worst k pids, one pass over the rows
+    if (top.k > 0) {
+        for (size_t i = 0; i < table.count; i++) {
+            top_count(&top, table.rows[i].node_pid, row_path(&table, &table.rows[i]));
+        }
+        print_top(&top, load == NULL);
+    }
+
+    // fds rolled up by owner, one pass over the rows
+    if (by.nviews > 0) {
+        for (size_t i = 0; i < table.count; i++) {
+            group_count(&by, table.rows[i].node_pid);
         }
+        print_groups(&by);
     }
-    // free linkedlist
-    pidstruct* temp;
-    while (head != NULL) {
-        temp = head;
-        head = head->next;
-        free(temp);
+
+    // who holds a file, socket or pipe
+    if (holders != NULL) {
+        holderindex index;
+        holders_build(&table, &index);
+        print_holders(&table, &index, holders, netp, load == NULL);
+        holders_free(&index);
     }
+    table_free(&table);
+    net_free(&net);
+    free(top.heap);
+    groupby_free(&by);
+    select_free(&sel);
+    if (snap_map != NULL) {munmap(snap_map, snap_size);}
+    STATS_PRINT(run_start);
     return 0;
 }
 
-void loop_pid(int pid, pidstruct** head){
-    ///_|> descry: if no pid is given, loops through /proc to find all active pids and calls on loop_fd, else call on loop_fd using given pid
-    ///_|> pid: stores pid argument 
-    ///_|> head: pidstruct linkedlist head to pass on
-    ///_|> returning: returns nothing   
+void stream_scan(pidselect* sel, int per_process, int systemWide, int Vnodes, int composite, int format, int summary, int threshold, int output_txt, int output_b, netinfo *net, topheap *top, groupby *by, filterstruct *filter){
+    ///_|> descry: --stream mode, scans serially and sends every row straight to the selected tables, output files and summary counts
+    ///_|> sel: pid selectors
+    ///_|> per_process, systemWide, Vnodes, composite: selected tables, rows of more than one table are interleaved
+    ///_|> format: table type the composite table is printed as
+    ///_|> summary: summary flag
+    ///_|> threshold: threshold value, -1 for none
+    ///_|> output_txt, output_b: output file flags
+    ///_|> net: socket tables, NULL when --sockets is off
+    ///_|> top: --top ranking, NULL for none
+    ///_|> by: --by views, NULL for none
+    ///_|> filter: row filters
+    ///_|> returning: returns nothing
 
-    DIR *dir;
-    struct dirent *dp; 
-
-    // Check if user directory can be openned if no specifc pid
-    if (pid == -1) {
-        dir = opendir("/proc");  
-        if (dir == NULL) {
-            fprintf(stderr, "Cannot open current file directory\n");
-            closedir(dir);
-            exit(1);
-        }
+    inodecache cache;
+    memset(&cache, 0, sizeof(cache));
+    rowsink sink;
+    memset(&sink, 0, sizeof(sink));
+    sink.cache = &cache;
+    sink.filter = filter;
+    sink.stream = 1;
+    sink.net = net;
+    sink.top = top;
+    sink.by = by;
+    sink.show[1] = per_process;
+    sink.show[2] = systemWide;
+    sink.show[3] = Vnodes;
+    sink.show[format] = composite;
 
-        // loops through for each pid
-        while ((dp = readdir (dir)) != NULL) {  
-            char file_name[256];
-            strcpy(file_name, dp->d_name);
+    // counts only grow with the number of pids, not fds
+    pidcountmap countmap = {NULL, 0, NULL, 0};
+    if (summary == 1 || threshold != -1) {sink.countmap = &countmap;}
+    outwriter txt;
+    if (output_txt == 1 && output_open(&txt, "compositeTable.txt") == 0) {sink.txt = &txt;}
 
-            // check if pid is a digit
-            if (isdigit(file_name[0])){
-                int pidvar = (int)(strtol(file_name, NULL,10)); 
+    // the snapshot is columnar, so its rows are kept until the scan ends
+    fdtable snap;
+    memset(&snap, 0, sizeof(snap));
+    if (output_b == 1) {sink.snap = &snap;}
 
-                // find info about pid and add to linkedlist
-               loop_fd(pidvar, head);
-            }
-        }
-        closedir(dir);
-    } else {
-        // specific pid inputed
-        loop_fd(pid, head);  
+    for (int table_type = 1; table_type <= FORMAT_NDJSON; table_type++) {
+        if (sink.show[table_type] == 1) {print_header(table_type);}
     }
+
+    // rows are written through one buffer, stdio is flushed around it so headers and footers stay in place
+    fflush(stdout);
+    outwriter out;
+    out_init(&out, STDOUT_FILENO);
+    sink.out = &out;
+    loop_pid(sel, &sink, 1);
+    STATS_START(output_start);
+    out_free(&out);
+    for (int table_type = 1; table_type <= FORMAT_NDJSON; table_type++) {
+        if (sink.show[table_type] == 1) {print_footer(table_type);}
+    }
+
+    if (sink.txt != NULL) {output_close(sink.txt);}
+    if (sink.snap != NULL) {output_binary(&snap);}
+    table_free(&snap);
+    STATS_STOP(STATS_OUTPUT, output_start);
+    STATS_START(summary_start);
+    if (summary == 1) {print_summary(&countmap);}
+    if (threshold != -1) {print_threshold(&countmap, threshold);}
+    if (summary == 1 || threshold != -1) {STATS_STOP(STATS_SUMMARY, summary_start);}
+    if (top != NULL) {print_top(top, 1);}
+    if (by != NULL) {print_groups(by);}
+    countmap_free(&countmap);
+    cache_free(&cache);
 }
 
-void loop_fd(int pid, pidstruct** head){
-    //_|> descry: for each pid, find all fds, the find corresponding filename and inode. Calls create_node to store in linked list 
-    ///_|> pid: stores pid argument 
-    ///_|> head: pidstruct linkedlist head to pass on
-    ///_|> returning: returns nothing 
+void watch_scan(pidselect* sel, filterstruct *filter, double interval, const char *archive, int jobs){
+    ///_|> descry: --watch mode, rescans every interval seconds and prints the fds opened and closed since the last scan with per pid count changes
+    ///_|> sel: pid selectors
+    ///_|> filter: row filters
+    ///_|> interval: seconds between scans
+    ///_|> archive: archive every scan is appended to, NULL for none
+    ///_|> jobs: number of scan threads
+    ///_|> returning: runs until interrupted
 
-    DIR *pdir;
-    struct dirent *pdp;
-    
-    // create path
-    char file_path[1000]; 
-    sprintf(file_path, "/proc/%d/fd", pid);
+    // each scan keeps the stat key of its rows, an fd that still points at the same open file takes its row from the
+    // last scan and is not readlinked again. The socket and pipe cache outlives each scan too
+    inodecache cache;
+    memset(&cache, 0, sizeof(cache));
+    fdtable prev, cur;
+    memset(&prev, 0, sizeof(prev));
+    struct timespec pause;
+    pause.tv_sec = (time_t)interval;
+    pause.tv_nsec = (long)((interval - (double)pause.tv_sec) * 1e9);
 
-    // Open fds for pid
-    pdir = opendir(file_path);
-    if (pdir == NULL) {
-        closedir(pdir);
-        return;
+    for (int scan = 1;; scan++) {
+        memset(&cur, 0, sizeof(cur));
+        cur.keyed = 1;
+        rowsink sink;
+        memset(&sink, 0, sizeof(sink));
+        sink.table = &cur;
+        sink.cache = &cache;
+        sink.filter = filter;
+        sink.prev = scan == 1 ? NULL : &prev;
+        loop_pid(sel, &sink, jobs);
+        qsort(cur.rows, cur.count, sizeof(pidstruct), row_cmp);
+        qsort(cur.keys, cur.nkeys, sizeof(watchkey), key_cmp);
+        if (archive != NULL) {archive_append(archive, &cur);}
+
+        if (scan == 1) {
+            printf("         Watching %zu fds every %gs\n", cur.count, interval);
+        } else {
+            watch_diff(&prev, &cur, scan);
+        }
+        fflush(stdout);
+        table_free(&prev);
+        prev = cur;
+        nanosleep(&pause, NULL);
     }
+}
 
-    // Skips first two directories . and ..
-    readdir(pdir); 
-    readdir(pdir); 
+int row_cmp(const void *a, const void *b){
+    //_|> descry: qsort order of rows, by pid then fd
+    //_|> a, b: rows to compare
+    ///_|> returning: returns <0, 0 or >0
 
-    // loop through each pid, fd pair
-    while ((pdp = readdir(pdir)) != NULL) {  
+    const pidstruct *ra = (const pidstruct *)a, *rb = (const pidstruct *)b;
+    if (ra->node_pid != rb->node_pid) {return ra->node_pid < rb->node_pid ? -1 : 1;}
+    return (ra->fd > rb->fd) - (ra->fd < rb->fd);
+}
 
-        //store fd
-        char fd[256];
-        strcpy(fd, pdp->d_name); 
+int key_cmp(const void *a, const void *b){
+    //_|> descry: qsort order of watchkeys, by pid then fd like the rows
+    //_|> a, b: watchkeys to compare
+    ///_|> returning: returns <0, 0 or >0
 
-        // Store symbolic link
-        char file_name[1000] = {"\0"};
-        char fd_path[1000];
-        sprintf(fd_path, "/proc/%d/fd/%s", pid, fd);
+    const watchkey *ka = (const watchkey *)a, *kb = (const watchkey *)b;
+    if (ka->node_pid != kb->node_pid) {return ka->node_pid < kb->node_pid ? -1 : 1;}
+    return (ka->fd > kb->fd) - (ka->fd < kb->fd);
+}
 
-        // Find file_name
-        size_t link_return = readlink(fd_path, file_name, sizeof(file_name));
-        if ((int)link_return != -1){
+void keep_key(rowsink* sink, inodekey* key){
+    //_|> descry: records the stat key of the row just appended to a keyed table, so the next --watch scan can reuse it
+    //_|> sink: sink the row went to
+    //_|> key: stat key of the row's fd
+    ///_|> returning: returns nothing, nothing for a sink that is not a keyed table
 
-            //readlink does not null terminate
-            file_name[link_return] = '\0'; 
-        } else if ((int)link_return == -1){
+    fdtable *table = sink->table;
+    if (sink->stream != 0 || table == NULL || table->keyed == 0) {return;}
+    pidstruct *row = &table->rows[table->count - 1];
+    watchkey *kept = &table->keys[table->nkeys++];
+    kept->node_pid = row->node_pid;
+    kept->fd = row->fd;
+    kept->inode = row->inode;
+    kept->path_id = row->path_id;
+    kept->mnt = key->mnt;
+    kept->dev = key->dev;
+    kept->ino = key->ino;
+}
 
-            // Cannot access file_name, create pid and fd pair only
-            create_node(pid, fd, "None", -1, head);
-            closedir(pdir);
-            return;
-        }
+watchkey *key_find(fdtable* table, int pid, int fd){
+    //_|> descry: binary search of a keyed table's sorted keys for one pid and fd
+    //_|> table: keyed table of the last scan, keys sorted with key_cmp
+    //_|> pid, fd: fd to find
+    ///_|> returning: returns its key, NULL if it had none
 
-        // find inode num
-        struct stat sb;
-        ino_t inode = 0;
-        int stat_return =  lstat(file_name, &sb);
-        if (stat_return == 0){
-            inode = sb.st_ino;
-        } else {
+    size_t lo = 0, hi = table->nkeys;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        watchkey *kept = &table->keys[mid];
+        if (kept->node_pid == pid && kept->fd == fd) {return kept;}
+        if (kept->node_pid < pid || (kept->node_pid == pid && kept->fd < fd)) {lo = mid + 1;}
+        else {hi = mid;}
+    }
+    return NULL;
+}
+
+void watch_diff(fdtable* prev, fdtable* cur, int scan){
+    ///_|> descry: walks two scans sorted by pid and fd together, printing fds only in prev as closed, only in cur as opened, then the pids whose count changed
+    ///_|> prev, cur: sorted tables of the last and this scan
+    ///_|> scan: scan number
+    ///_|> returning: returns nothing, prints nothing if no fd changed
+
+    piddelta *deltas = NULL;
+    int ndeltas = 0, cap = 0, opened = 0, closed = 0;
+    size_t i = 0, j = 0;
+    while (i < prev->count || j < cur->count) {
+        pidstruct *old = i < prev->count ? &prev->rows[i] : NULL;
+        pidstruct *now = j < cur->count ? &cur->rows[j] : NULL;
+
+        // same pid and fd, it was reopened if it points elsewhere now
+        int order = old == NULL ? 1 : now == NULL ? -1 : row_cmp(old, now);
+        int changed = order == 0 && (old->inode != now->inode || strcmp(row_path(prev, old), row_path(cur, now)) != 0);
+        int row_pid = order <= 0 ? old->node_pid : now->node_pid;
 
-            // if file_name is a pipe/socket, use the inode in file_name. If anon_inode, show as 0
-            char sentence[500];
-            strcpy(sentence, file_name);
-            char *inode_str = strtok(sentence, "[:]");
-            if (inode_str != NULL) {
-                inode_str = strtok(NULL, "[:]"); 
-                if (inode_str != NULL) {
-                    inode = strtol(inode_str, NULL, 10); 
-                } else {
-                    inode = -1; // Erro val
+        // new pid group, rows come in pid order so only the last delta can match
+        if (ndeltas == 0 || deltas[ndeltas - 1].node_pid != row_pid) {
+            if (ndeltas == cap) {
+                cap = cap == 0 ? COUNT_START : cap * 2;
+                piddelta *grown = (piddelta *)realloc(deltas, cap * sizeof(piddelta));
+                if (grown == NULL) {
+                    fprintf(stderr, "Insufficient memory");
+                    exit(1);
                 }
+                deltas = grown;
             }
+            deltas[ndeltas].node_pid = row_pid;
+            deltas[ndeltas].count = 0;
+            deltas[ndeltas].delta = 0;
+            ndeltas++;
         }
+        piddelta *delta = &deltas[ndeltas - 1];
 
-        //link entry to linkedlist
-        create_node(pid, fd, file_name, inode, head);
-    }   
+        if (order < 0 || changed) {
+            if (opened + closed == 0) {watch_header(scan);}
+            printf("      -  %d        %d       %s     %ld\n", old->node_pid, old->fd, row_path(prev, old), old->inode);
+            closed++;
+        }
+        if (order > 0 || changed) {
+            if (opened + closed == 0) {watch_header(scan);}
+            printf("      +  %d        %d       %s     %ld\n", now->node_pid, now->fd, row_path(cur, now), now->inode);
+            opened++;
+        }
+        if (order < 0) {delta->delta--; i++;}
+        else if (order > 0) {delta->delta++; delta->count++; j++;}
+        else {delta->count++; i++; j++;}
+    }
 
-    closedir(pdir);
+    if (opened + closed > 0) {
+        printf("        ========================================================\n");
+        printf("         %d opened, %d closed\n", opened, closed);
+        int header = 0;
+        for (int d = 0; d < ndeltas; d++) {
+            if (deltas[d].delta != 0 && header++ == 0) {printf("         PID    FDs     Change\n");}
+            if (deltas[d].delta != 0) {printf("         %d   %d     %+d\n", deltas[d].node_pid, deltas[d].count, deltas[d].delta);}
+        }
+        printf("\n");
+    }
+    free(deltas);
 }
 
+void watch_header(int scan){
+    //_|> descry: prints the heading of one scan's changes with the time of the scan
+    //_|> scan: scan number
+    ///_|> returning: returns nothing
 
-void print_table(pidstruct* head, int table_type){
-    ///_|> descry: loops through pidstruct linked list to print per-process systemwide vnode or composite table, given table_type
-    ///_|> head: head of pid struct linkedlist 
-    ///_|> table_type: stores which table to print
-    ///_|> returning: returns nothing 
-
-    //print header
-    print_header(table_type);
-
-    // iterate through linked list
-    pidstruct* curr = head;
-    while (curr != NULL) {
-
-        //store vals
-        int pid = curr->node_pid;
-        int fd = curr->fd;
-        char file_name[1000];
-        strcpy(file_name, curr->file_name);
-        int inode = curr->inode;
-
-        //print vals
-        if (table_type == 1){
-            printf("         %d       %d\n", pid, fd);
-        } else if (table_type == 2 && strcmp("None", file_name) != 0){
-            printf("         %d     %d       %s\n", pid, fd, file_name);
-        } else if (table_type == 3){
-            printf("         %d      %d\n", fd, inode);
-        } else if (table_type == 4 && strcmp("None", file_name) != 0){
-            printf("       %d        %d       %s     %d\n",pid, fd, file_name, inode); 
-        }
-        curr = curr->next;
-    }
-    printf("       ========================================================\n");
+    char now[32];
+    time_t when = time(NULL);
+    strftime(now, sizeof(now), "%H:%M:%S", localtime(&when));
+    printf("         Scan %d at %s\n", scan, now);
+    printf("         +/-  PID    FD      Filename       Inode\n");
+    printf("        ========================================================\n");
 }
 
-void print_header(int table_type){
-    //_|> descry: helper function to print header
-    ///_|> table_type: stores table type
-    ///_|> returning: returns nothing 
+void leak_scan(pidselect* sel, filterstruct *filter, double interval){
+    ///_|> descry: --leaks mode, samples the fd count of every pid each interval and reports the ones climbing steadily towards their open files limit
+    ///_|> sel: pid selectors, matched again every round so new matches and children are picked up
+    ///_|> filter: uid and comm filters, the others need fds resolved and do not apply to counts
+    ///_|> interval: seconds between samples
+    ///_|> returning: runs until interrupted
 
-    switch (table_type) {
-        case 1:
-            printf("         PID    FD \n");
-            printf("        ========================================================\n");
-          break;
-        case 2:
-            printf("         PID    FD      Filename \n");  
-            printf("        ========================================================\n");
-            break;
-        case 3:
-            printf("         FD     Inode\n");
-            printf("        ========================================================\n");
-          break;
-        case 4:
-              printf("         PID    FD      Filename       Inode\n");
-            printf("        ========================================================\n");
-          break;
-      }
-    }  
+    leakmap leaks;
+    memset(&leaks, 0, sizeof(leaks));
+    struct timespec pause, last, now;
+    pause.tv_sec = (time_t)interval;
+    pause.tv_nsec = (long)((interval - (double)pause.tv_sec) * 1e9);
+    clock_gettime(CLOCK_MONOTONIC, &last);
 
-void parse_arguments(int argc, char *argv[], int *per_process, int *systemWide, int *Vnodes, int *composite, int *summary, int *threshold, int *pid, int* output_txt, int* output_b)
-{
-    //_|> descry: processes all argument and updates pointers in main
-    //_|> argc: argument count
-    //_|> argv: input
-    //_|> per_process: per-process flag
-    //_|> systemWide: systemWide flag
-    //_|> Vnodes: vnodes flag
-    //_|> composite: composite flag
-    //_|> summary: summary flag
-    //_|> threshold: threshold value
-    //_|> pid: pid value
-    //_|> output_txt: output ascii file flag
-    //_|> output_b: output binary file flag
-    ///_|> returning: returns nothing 
+    for (int round = 1;; round++) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double dt = (double)(now.tv_sec - last.tv_sec) + (double)(now.tv_nsec - last.tv_nsec) / 1e9;
+        last = now;
 
-    int arg_num = 1;
-    for (; arg_num < argc; arg_num++)
-    {
-        if (isdigit(argv[arg_num][0])){*pid = atoi(argv[arg_num]);}
-        else if (strcmp(argv[arg_num], "--per-process") == 0){*per_process = 1;}
-        else if (strcmp(argv[arg_num], "--systemWide") == 0){*systemWide = 1;}
-        else if (strcmp(argv[arg_num], "--Vnodes") == 0){*Vnodes = 1;}
-        else if (strcmp(argv[arg_num], "--composite") == 0){*composite = 1;}
-        else if (strcmp(argv[arg_num], "--summary") == 0){*summary = 1;}
-        else if (strncmp(argv[arg_num], "--threshold=", 12) == 0){*threshold = atoi(argv[arg_num] + 12);}
-        else if (strcmp(argv[arg_num], "--output_TXT") == 0){*output_txt = 1;}
-        else if (strcmp(argv[arg_num], "--output_binary") == 0){*output_b = 1; } 
-        else    
-        {
-            //incorrect arguments
-            fprintf(stderr, "Arguments incorrect\n");
-            exit(1);
+        // one count per pid, straight from the fd directory
+        int *pids;
+        int npids = select_pids(sel, &pids);
+        for (int i = 0; i < npids; i++) {
+            if (filter_pid(filter, pids[i]) == 0) {continue;}
+            long long start = read_start(pids[i]);
+            int count = count_fds(pids[i]);
+            if (start < 0 || count < 0) {continue;}
+            leak_sample(leak_find(&leaks, pids[i], start), count, round, dt);
         }
-    }
+        free(pids);
 
-    // no arguments not including output file, print composite
-    if (*per_process == 0 && *systemWide == 0 && *Vnodes == 0 && *composite == 0 && *summary == 0 && *threshold == -1) {
-        *composite = 1;
+        // forget exited pids so only live ones take memory
+        leak_compact(&leaks, round);
+        leak_report(&leaks, round);
+        fflush(stdout);
+        nanosleep(&pause, NULL);
     }
 }
 
-void create_node(int pid, char *fd, char *file_name, ino_t inode, pidstruct** head){
-    //_|> descry: creates a node to store pid,fd,filename and inode in pidstruct linkedlist
-    ///_|> pid: pid of current loop
-    //_|> fd: fd of current loop
-    //_|>filename: corresponding filename
-    //_|>inode: corresponding inode
-    //_|> head: head pointor for pidstruct linkedlist
-    ///_|> returning: returns nothing 
+int list_pids(int **pids){
+    //_|> descry: lists the pids in /proc in /proc order
+    //_|> pids: set to a malloced array of pids
+    ///_|> returning: returns the number of pids, exits if /proc cannot be read
 
-    // find last node
-    pidstruct* curr = *head;
-    pidstruct* prev = NULL;
-    while (curr!= NULL){
-        prev = curr;
-        curr = curr->next;
+    STATS_START(start);
+    DIR *dir;
+    struct dirent *dp;
+    dir = opendir(proc_root);
+    if (dir == NULL) {
+        fprintf(stderr, "Cannot open current file directory\n");
+        exit(1);
     }
 
-    // create node
-    pidstruct* node =  (pidstruct* )malloc(sizeof (pidstruct));
-    if (node == NULL) {
+    int npids = 0, cap = 1024;
+    *pids = (int *)malloc(cap * sizeof(int));
+    if (*pids == NULL) {
         fprintf(stderr, "Insufficient memory");
-        return;
+        exit(1);
     }
 
-    //insert vals
-    node->node_pid = pid;
-    node->fd = (int)strtol(fd, NULL, 10 );
-    strncpy(node->file_name, file_name, sizeof(node->file_name));
-    node->inode = inode;
-    node->next = NULL;
-
-    // if no head node ,set as head
-    if (*head == NULL){
-        *head = node;
-    } else {
+    // loops through for each pid
+    while ((dp = readdir (dir)) != NULL) {
 
-        //link at end
-        prev -> next = node;
+        // check if pid is a digit
+        if (isdigit(dp->d_name[0])){
+            if (npids == cap) {
+                cap *= 2;
+                int *grown = (int *)realloc(*pids, cap * sizeof(int));
+                if (grown == NULL) {
+                    fprintf(stderr, "Insufficient memory");
+                    exit(1);
+                }
+                *pids = grown;
+            }
+            (*pids)[npids++] = (int)(strtol(dp->d_name, NULL,10));
+        }
     }
+    closedir(dir);
+    STATS_STOP(STATS_LIST, start);
+    return npids;
 }
 
-void summary_list(pidstruct* head, pidcountstruct** counthead){
-    //_|> descry: iterates through pidstruct linkedlist and calls on summary_count to create pidcountstruct list
-    ///_|> head: head pointer of pidstruct
-    //_|> counthead: head pointer of pidcountstruct
-    ///_|> returning: returns nothing 
+int select_pids(pidselect* sel, int **pids){
+    //_|> descry: lists the pids to scan, in pid order, each once
+    //_|> sel: pid selectors
+    //_|> pids: set to a malloced array of pids
+    ///_|> returning: returns the number of pids
 
-    //iterate through pidstruct linked list
-    pidstruct* curr = head;
-    while (curr!= NULL){
-        int pid = curr->node_pid;
+    // nothing selected, every pid
+    if (sel->nranges == 0 && sel->nnames == 0 && sel->nregexes == 0) {return list_pids(pids);}
 
-        //count num of occurrances for each pid
-        summary_count(pid, counthead);
-        curr = curr->next;
+    // single pids are taken as given, they may be threads /proc does not list
+    int listed = sel->nnames > 0 || sel->nregexes > 0 || sel->children == 1;
+    for (int r = 0; r < sel->nranges; r++) {
+        if (sel->ranges[2 * r] != sel->ranges[2 * r + 1]) {listed = 1;}
     }
-}
-
-void summary_count(int pid, pidcountstruct** counthead){
-    //_|> descry: iterates through pidcountstruct linked list, if there exists pid num count+1, else create new node for pid val
-    //_|> counthead: head pointer of pidcountstruct
-    ///_|> returning: returns nothing 
-
-    //iterate through pidcountstruct list
-    pidcountstruct* curr = *counthead;
-    pidcountstruct* prev = NULL;
+    int *all = NULL;
+    int nall = listed == 1 ? list_pids(&all) : 0;
+    *pids = (int *)malloc((nall + sel->nranges + 1) * sizeof(int));
+    if (*pids == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    int npids = 0;
+    for (int r = 0; r < sel->nranges; r++) {
+        if (sel->ranges[2 * r] == sel->ranges[2 * r + 1]) {(*pids)[npids++] = sel->ranges[2 * r];}
+    }
+    for (int i = 0; i < nall; i++) {
+        if (select_match(sel, all[i]) == 1) {(*pids)[npids++] = all[i];}
+    }
+    if (sel->children == 1) {npids = select_children(all, nall, pids, npids);}
+    free(all);
 
-    while (curr!= NULL){
+    // pid order, duplicates dropped
+    qsort(*pids, npids, sizeof(int), pid_cmp);
+    int nunique = 0;
+    for (int i = 0; i < npids; i++) {
+        if (nunique == 0 || (*pids)[nunique - 1] != (*pids)[i]) {(*pids)[nunique++] = (*pids)[i];}
+    }
+    return nunique;
+}
 
-        // if matching pid, count++
-        if(curr->node_pid == pid){
-            curr -> count += 1;
-            return; 
-        }
+int select_match(pidselect* sel, int pid){
+    //_|> descry: checks a listed pid against the ranges, then the names and regexes, comm is read only if needed
+    //_|> sel: pid selectors
+    //_|> pid: pid to check
+    ///_|> returning: returns 1 if selected, 0 if not
 
-        // Non matching pid, move through list
-        prev = curr;
-        curr = curr->next;
+    for (int r = 0; r < sel->nranges; r++) {
+        if (pid >= sel->ranges[2 * r] && pid <= sel->ranges[2 * r + 1]) {return 1;}
+    }
+    if (sel->nnames == 0 && sel->nregexes == 0) {return 0;}
+    char comm[64];
+    if (read_comm(pid, comm, sizeof(comm)) != 0) {return 0;}
+    for (int n = 0; n < sel->nnames; n++) {
+        if (strcmp(comm, sel->names[n]) == 0) {return 1;}
+    }
+    for (int n = 0; n < sel->nregexes; n++) {
+        if (regexec(&sel->regexes[n], comm, 0, NULL, 0) == 0) {return 1;}
     }
+    return 0;
+}
 
-    //no matching pid, create new node
-    pidcountstruct* node = (pidcountstruct *)malloc(sizeof(pidcountstruct));
-    if (node == NULL) {
+int select_children(int *all, int nall, int **pids, int npids){
+    //_|> descry: --children, adds every descendant of the selected pids, from one pass over /proc/<pid>/stat that indexes pids by parent
+    //_|> all: every pid in /proc
+    //_|> nall: number of pids in all
+    //_|> pids: selected pids, grown to hold the descendants too
+    //_|> npids: number of selected pids
+    ///_|> returning: returns the new number of pids
+
+    pidparent *parents = (pidparent *)malloc((nall + 1) * sizeof(pidparent));
+    int *grown = (int *)realloc(*pids, (npids + nall + 1) * sizeof(int));
+    if (parents == NULL || grown == NULL) {
         fprintf(stderr, "Insufficient memory");
-        return;
+        exit(1);
     }
-    node->node_pid = pid;
-    node->count = 1;
-    node->next = NULL;
+    *pids = grown;
+    int nparents = 0;
+    for (int i = 0; i < nall; i++) {
+        int ppid = read_ppid(all[i]);
+        if (ppid < 0) {continue;}
+        parents[nparents].ppid = ppid;
+        parents[nparents].pid = all[i];
+        nparents++;
+    }
+    qsort(parents, nparents, sizeof(pidparent), parent_cmp);
 
-    //if no head, set as head node, otherwise link at end
-    if (*counthead == NULL){
-        *counthead = node;
-    } else {
-        prev -> next = node;
+    // walk down from each selected pid, the pids list doubles as the queue and each parent entry is used once, so it holds at most nall more
+    for (int head = 0; head < npids; head++) {
+        int lo = 0, hi = nparents;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (parents[mid].ppid < (*pids)[head]) {lo = mid + 1;} else {hi = mid;}
+        }
+        for (; lo < nparents && parents[lo].ppid == (*pids)[head]; lo++) {
+            if (parents[lo].pid == -1) {continue;}
+            (*pids)[npids++] = parents[lo].pid;
+            parents[lo].pid = -1;
+        }
     }
+    free(parents);
+    return npids;
 }
 
-void print_summary(pidcountstruct* counthead) {
-    //_|> descry: loops through pidcountstruct to print pid and num of occurances
-    //_|> counthead: head pointer of pidcountstruct
-    ///_|> returning: returns nothing 
+int read_ppid(int pid){
+    //_|> descry: reads the parent pid from /proc/<pid>/stat, after the command name in parentheses which may hold spaces
+    //_|> pid: pid to read
+    ///_|> returning: returns the parent pid, -1 if the pid is gone
 
-    pidcountstruct* curr = counthead;
-    printf("         Summary Table\n");
-    printf("         =============\n");
+    char file_path[PATH_BUFFER];
+    snprintf(file_path, sizeof(file_path), "%s/%d/stat", proc_root, pid);
+    int stat_fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    if (stat_fd == -1) {return -1;}
+    char buf[512];
+    ssize_t len = read(stat_fd, buf, sizeof(buf) - 1);
+    close(stat_fd);
+    if (len <= 0) {return -1;}
+    buf[len] = '\0';
 
-    //iterate through pidcountstruct to print 
-    while (curr != NULL) {
-        printf("%d (%d),  ", curr->node_pid, curr->count);
-        curr = curr->next;
+    // "pid (comm) state ppid ..."
+    char *close_paren = strrchr(buf, ')');
+    if (close_paren == NULL || close_paren[1] != ' ' || close_paren[2] == '\0' || close_paren[3] != ' ') {return -1;}
+    return atoi(close_paren + 4);
+}
+
+long long read_start(int pid){
+    //_|> descry: reads the start time of a pid from field 22 of /proc/<pid>/stat, after the command name in parentheses which may hold spaces
+    //_|> pid: pid to read
+    ///_|> returning: returns the start time in clock ticks since boot, -1 if the pid is gone
+
+    char file_path[PATH_BUFFER];
+    snprintf(file_path, sizeof(file_path), "%s/%d/stat", proc_root, pid);
+    int stat_fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    if (stat_fd == -1) {return -1;}
+    char buf[1024];
+    ssize_t len = read(stat_fd, buf, sizeof(buf) - 1);
+    close(stat_fd);
+    if (len <= 0) {return -1;}
+    buf[len] = '\0';
+
+    // "pid (comm) state ppid ...", state is field 3
+    char *pos = strrchr(buf, ')');
+    if (pos == NULL || pos[1] != ' ') {return -1;}
+    pos += 2;
+    for (int field = 3; field < 22; field++) {
+        pos = strchr(pos, ' ');
+        if (pos == NULL) {return -1;}
+        pos++;
     }
-    printf("\n\n");
+    if (!isdigit((unsigned char)*pos)) {return -1;}
+    return strtoll(pos, NULL, 10);
 }
 
+int pid_cmp(const void *a, const void *b){
+    //_|> descry: qsort order of pids
+    //_|> a, b: pids to compare
+    ///_|> returning: returns <0, 0 or >0
 
-void print_threshold(pidcountstruct* counthead, int threshold) {
-    //_|> descry: iterates through pidcountstruct linked list, prints threshold table by comparing threshold to count 
-    //_|> counthead: head pointer of pidcountstruct
-    ///_|> returning: returns nothing 
+    int pa = *(const int *)a, pb = *(const int *)b;
+    return (pa > pb) - (pa < pb);
+}
 
-    pidcountstruct* curr = counthead;
-    printf("## Offending processes:\n");
+int parent_cmp(const void *a, const void *b){
+    //_|> descry: qsort order of pidparents, by parent then pid
+    //_|> a, b: pidparents to compare
+    ///_|> returning: returns <0, 0 or >0
 
-    //iterate through pidcountstruct to print 
-    while (curr != NULL) {
-        // Add threshold condition
-        if (curr->count >= threshold){
-            printf("%d (%d),  ", curr->node_pid, curr->count);
+    const pidparent *pa = (const pidparent *)a, *pb = (const pidparent *)b;
+    if (pa->ppid != pb->ppid) {return pa->ppid < pb->ppid ? -1 : 1;}
+    return (pa->pid > pb->pid) - (pa->pid < pb->pid);
+}
+
+void parse_selector(char *arg, pidselect* sel){
+    //_|> descry: adds a pid argument to the selectors, a comma separated list of pids and A-B ranges (A- for no upper bound)
+    //_|> arg: pid argument
+    //_|> sel: pid selectors to add to
+    ///_|> returning: returns nothing, exits on a malformed list
+
+    char *pos = arg;
+    while (1) {
+        char *end;
+        long lo = strtol(pos, &end, 10), hi = lo;
+        if (end == pos || lo < 0 || lo > INT_MAX) {
+            fprintf(stderr, "Arguments incorrect\n");
+            exit(1);
+        }
+        if (*end == '-') {
+            pos = end + 1;
+            end = pos;
+            hi = INT_MAX;
+            if (isdigit((unsigned char)*pos)) {hi = strtol(pos, &end, 10);}
+            if (hi < lo || hi > INT_MAX) {
+                fprintf(stderr, "Arguments incorrect\n");
+                exit(1);
+            }
+        }
+        if (*end != ',' && *end != '\0') {
+            fprintf(stderr, "Arguments incorrect\n");
+            exit(1);
+        }
+
+        int *grown = (int *)realloc(sel->ranges, (sel->nranges + 1) * 2 * sizeof(int));
+        if (grown == NULL) {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
         }
-        curr = curr->next;
+        sel->ranges = grown;
+        sel->ranges[2 * sel->nranges] = (int)lo;
+        sel->ranges[2 * sel->nranges + 1] = (int)hi;
+        sel->nranges++;
+        if (*end == '\0') {break;}
+        pos = end + 1;
     }
-    printf("\n\n");
 }
 
-void output_text(pidstruct* head ){
-    //_|> descry: saves composite table to txt file
-    //_|> head: head pointer for pidstruct
-    ///_|> returning: returns nothing 
+void select_free(pidselect* sel){
+    //_|> descry: frees the pid selectors
+    //_|> sel: pid selectors to free
+    ///_|> returning: returns nothing
 
-    // generate file or overwrite
-    FILE *fptr;
-    fptr = fopen("compositeTable.txt", "w");
-    if (fptr == NULL) {
-        fprintf(stderr, "Error creating file");
-        return;
+    for (int n = 0; n < sel->nregexes; n++) {
+        regfree(&sel->regexes[n]);
     }
+    free(sel->ranges);
+    free(sel->names);
+    free(sel->regexes);
+    memset(sel, 0, sizeof(pidselect));
+}
 
-    //write to file
-    fprintf(fptr, "        PID    FD      Filename       Inode\n");
-    fprintf(fptr, "       ========================================================\n");
-    pidstruct* curr = head;
+int count_fds(int pid){
+    //_|> descry: counts the open fds of a pid without resolving any of them
+    //_|> pid: pid to count
+    ///_|> returning: returns the fd count, -1 if the pid is gone or not readable
+
+    // the size of an fd directory is its fd count on newer kernels, 0 on older ones
+    char file_path[PATH_BUFFER];
+    snprintf(file_path, sizeof(file_path), "%s/%d/fd", proc_root, pid);
+    int dirfd = open(file_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd == -1) {return -1;}
+    struct stat sb;
+    if (fstat(dirfd, &sb) == 0 && sb.st_size > 0) {
+        close(dirfd);
+        return (int)sb.st_size;
+    }
 
-    // iterate through pidstruct list to print composite table
-    while (curr != NULL) {
-            int pid = curr->node_pid;
-            int fd = curr->fd;
-            char file_name[1000];
-            strcpy(file_name, curr->file_name);
-            int inode = curr->inode;
-            fprintf(fptr, "       %d        %d       %s     %d\n",pid, fd, file_name, inode); 
-            curr = curr->next;
+    int count = 0;
+    long dents[DENTS_BUFFER / sizeof(long)];
+    long nread;
+    while ((nread = syscall(SYS_getdents64, dirfd, dents, sizeof(dents))) > 0) {
+        for (long pos = 0; pos < nread;) {
+            linux_dirent64 *pdp = (linux_dirent64 *)((char *)dents + pos);
+            pos += pdp->d_reclen;
+            if (pdp->d_name[0] != '.') {count++;}
         }
-        fprintf(fptr,   "       ========================================================\n");
-    fclose(fptr);
     }
+    close(dirfd);
+    return count;
+}
 
-void output_binary(pidstruct* head){
-    //_|> descry: saves composite table to binary file
-    //_|> head: head pointer for pidstruct
-    ///_|> returning: returns nothing 
+leaktrack *leak_find(leakmap* leaks, int pid, long long start){
+    //_|> descry: finds the history of a pid, starting an empty one the first time it is seen or when the pid now belongs to another process
+    //_|> leaks: leakmap to search
+    //_|> pid: pid to find
+    //_|> start: start time of the process holding the pid now
+    ///_|> returning: returns the pid's leaktrack
 
-    // generate file or overwrite
+    if ((leaks->ntracks + 1) * 2 > leaks->nslots) {
+        leaks->nslots = leaks->nslots == 0 ? COUNT_START : leaks->nslots * 2;
+        leak_rehash(leaks);
+    }
+    unsigned int mask = (unsigned int)leaks->nslots - 1;
+    unsigned int slot = ((unsigned int)pid * 2654435761u) & mask;
+    while (leaks->slots[slot] != 0) {
+        leaktrack *curr = &leaks->tracks[leaks->slots[slot] - 1];
+        if (curr->node_pid == pid) {
+
+            // same pid, other process: none of the counts, rate or limit are its own
+            if (curr->start != start) {
+                memset(curr, 0, sizeof(leaktrack));
+                curr->node_pid = pid;
+                curr->start = start;
+                curr->limit = -1;
+            }
+            return curr;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (leaks->ntracks == leaks->cap) {
+        leaks->cap = leaks->cap == 0 ? COUNT_START : leaks->cap * 2;
+        leaktrack *grown = (leaktrack *)realloc(leaks->tracks, leaks->cap * sizeof(leaktrack));
+        if (grown == NULL) {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        leaks->tracks = grown;
+    }
+    leaktrack *track = &leaks->tracks[leaks->ntracks++];
+    memset(track, 0, sizeof(leaktrack));
+    track->node_pid = pid;
+    track->start = start;
+    track->limit = -1;
+    leaks->slots[slot] = leaks->ntracks;
+    return track;
+}
+
+void leak_rehash(leakmap* leaks){
+    //_|> descry: reallocates the leakmap slots at nslots and reinserts every pid
+    //_|> leaks: leakmap with nslots already set
+    ///_|> returning: returns nothing
+
+    free(leaks->slots);
+    leaks->slots = (int *)calloc(leaks->nslots, sizeof(int));
+    if (leaks->slots == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    unsigned int mask = (unsigned int)leaks->nslots - 1;
+    for (int i = 0; i < leaks->ntracks; i++) {
+        unsigned int slot = ((unsigned int)leaks->tracks[i].node_pid * 2654435761u) & mask;
+        while (leaks->slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        leaks->slots[slot] = i + 1;
+    }
+}
+
+void leak_sample(leaktrack* track, int count, int round, double dt){
+    //_|> descry: adds a count to a pid's ring of samples and folds the growth since the last sample into its EWMA rate
+    //_|> track: pid's leaktrack
+    //_|> count: fd count now
+    //_|> round: sample round
+    //_|> dt: seconds since the last round
+    ///_|> returning: returns nothing
+
+    if (track->nsamples > 0 && dt > 0) {
+        int prev = track->counts[(track->head + LEAK_SAMPLES - 1) % LEAK_SAMPLES];
+        double rate = (double)(count - prev) / dt;
+        track->ewma = track->nsamples == 1 ? rate : LEAK_ALPHA * rate + (1 - LEAK_ALPHA) * track->ewma;
+    }
+    track->counts[track->head] = count;
+    track->head = (track->head + 1) % LEAK_SAMPLES;
+    if (track->nsamples < LEAK_SAMPLES) {track->nsamples++;}
+    track->seen = round;
+}
+
+void leak_compact(leakmap* leaks, int round){
+    //_|> descry: drops the history of pids not seen this round, then rehashes the rest
+    //_|> leaks: leakmap to compact
+    //_|> round: current sample round
+    ///_|> returning: returns nothing
+
+    int kept = 0;
+    for (int i = 0; i < leaks->ntracks; i++) {
+        if (leaks->tracks[i].seen == round) {leaks->tracks[kept++] = leaks->tracks[i];}
+    }
+    if (kept == leaks->ntracks) {return;}
+    leaks->ntracks = kept;
+    leak_rehash(leaks);
+}
+
+int leak_steady(leaktrack* track){
+    //_|> descry: decides if a pid's fd count is climbing steadily, positive rate, grown over the ring and rising in most steps
+    //_|> track: pid's leaktrack
+    ///_|> returning: returns 1 if it looks like a leak, 0 if not
+
+    if (track->nsamples < LEAK_MIN_SAMPLES || track->ewma <= 0) {return 0;}
+    int oldest = (track->head + LEAK_SAMPLES - track->nsamples) % LEAK_SAMPLES;
+    int rising = 0, falling = 0, steps = track->nsamples - 1;
+    for (int k = 1; k < track->nsamples; k++) {
+        int a = track->counts[(oldest + k - 1) % LEAK_SAMPLES];
+        int b = track->counts[(oldest + k) % LEAK_SAMPLES];
+        if (b > a) {rising++;}
+        else if (b < a) {falling++;}
+    }
+    int newest = track->counts[(track->head + LEAK_SAMPLES - 1) % LEAK_SAMPLES];
+    return newest > track->counts[oldest] && rising * 2 >= steps && falling * 4 <= steps;
+}
+
+long read_nofile(int pid){
+    //_|> descry: reads the soft open files limit of a pid from /proc/<pid>/limits
+    //_|> pid: pid to read
+    ///_|> returning: returns the limit, 0 for unlimited, -1 if unknown
+
+    char file_path[PATH_BUFFER];
+    char limits[4096];
+    snprintf(file_path, sizeof(file_path), "%s/%d/limits", proc_root, pid);
+    int limits_fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    if (limits_fd == -1) {return -1;}
+    ssize_t len = read(limits_fd, limits, sizeof(limits) - 1);
+    close(limits_fd);
+    if (len <= 0) {return -1;}
+    limits[len] = '\0';
+
+    // Max open files    <soft>    <hard>    files
+    char *line = strstr(limits, "Max open files");
+    if (line == NULL) {return -1;}
+    line += 14;
+    while (*line == ' ') {line++;}
+    if (strncmp(line, "unlimited", 9) == 0) {return 0;}
+    return strtol(line, NULL, 10);
+}
+
+void leak_report(leakmap* leaks, int round){
+    //_|> descry: prints the pids whose fd count is climbing steadily, with the rate and how long until the open files limit at that rate
+    //_|> leaks: leakmap of every live pid
+    //_|> round: sample round
+    ///_|> returning: returns nothing, prints nothing if no pid is climbing
+
+    int header = 0;
+    for (int i = 0; i < leaks->ntracks; i++) {
+        leaktrack *track = &leaks->tracks[i];
+        if (leak_steady(track) == 0) {continue;}
+
+        // limit only changes through prlimit, read it once per pid
+        if (track->limit == -1) {track->limit = read_nofile(track->node_pid);}
+        if (header++ == 0) {
+            char now[32];
+            time_t when = time(NULL);
+            strftime(now, sizeof(now), "%H:%M:%S", localtime(&when));
+            printf("## Leaking processes, sample %d at %s:\n", round, now);
+            printf("         PID    Command          FDs     FDs/min     Limit     Time to limit\n");
+            printf("        ========================================================\n");
+        }
+        char comm[64] = "?";
+        read_comm(track->node_pid, comm, sizeof(comm));
+        int count = track->counts[(track->head + LEAK_SAMPLES - 1) % LEAK_SAMPLES];
+        char eta[32] = "-";
+        if (track->limit > count) {
+            long secs = (long)((double)(track->limit - count) / track->ewma);
+            if (secs < 3600) {snprintf(eta, sizeof(eta), "%ldm %lds", secs / 60, secs % 60);}
+            else {snprintf(eta, sizeof(eta), "%ldh %ldm", secs / 3600, secs % 3600 / 60);}
+        }
+        printf("         %-6d %-16s %-7d %-11.1f %-9ld %s\n", track->node_pid, comm, count, track->ewma * 60, track->limit, eta);
+    }
+    if (header > 0) {printf("\n");}
+}
+
+int read_comm(int pid, char *comm, size_t size){
+    //_|> descry: reads the command name of a pid from /proc/<pid>/comm
+    //_|> pid: pid to read
+    //_|> comm: filled with the command name
+    //_|> size: size of comm
+    ///_|> returning: returns 0 on success, -1 if the pid is gone
+
+    char proc_path[PATH_BUFFER];
+    snprintf(proc_path, sizeof(proc_path), "%s/%d/comm", proc_root, pid);
+    int comm_fd = open(proc_path, O_RDONLY | O_CLOEXEC);
+    if (comm_fd == -1) {return -1;}
+    ssize_t len = read(comm_fd, comm, size - 1);
+    close(comm_fd);
+    if (len <= 0) {return -1;}
+
+    // comm ends in a newline
+    comm[len] = '\0';
+    comm[strcspn(comm, "\n")] = '\0';
+    return 0;
+}
+
+void loop_pid(pidselect* sel, rowsink* sink, int jobs){
+    ///_|> descry: finds the selected pids, every active pid in /proc if none are selected, and calls on loop_fd for each
+    ///_|> sel: pid selectors
+    ///_|> sink: rowsink to pass on, parallel scan needs a table sink
+    ///_|> jobs: number of worker threads to scan with
+    ///_|> returning: returns nothing
+
+    // collect pids first so they can be split across workers, in pid order
+    int *pids;
+    int npids = select_pids(sel, &pids);
+
+    // find info about each pid and add to table
+    if (jobs > 1 && npids > 1 && sink->stream == 0) {
+        parallel_scan(pids, npids, sink, jobs);
+    } else {
+        for (int i = 0; i < npids; i++) {
+            loop_fd(pids[i], sink);
+
+            // streamed rows of each pid are written out once it is done, so the first rows show up right away
+            if (sink->out != NULL && sink->out->used > 0) {
+                STATS_START(flush_start);
+                out_flush(sink->out);
+                STATS_STOP(STATS_OUTPUT, flush_start);
+            }
+        }
+    }
+    free(pids);
+}
+
+void parallel_scan(int *pids, int npids, rowsink* sink, int jobs){
+    ///_|> descry: splits pids into batches scanned by worker threads, then appends the batch tables in pid order
+    ///_|> pids: pids in /proc order
+    ///_|> npids: number of pids
+    ///_|> sink: table sink to append to, its filter is used by every worker
+    ///_|> jobs: number of worker threads
+    ///_|> returning: returns nothing
+
+    fdtable *table = sink->table;
+    scanjob job;
+    job.filter = sink->filter;
+    job.prev = sink->prev;
+    job.pids = pids;
+    job.npids = npids;
+
+    // about four batches a worker so one busy pid does not hold up the rest, at most PID_BATCH pids each
+    job.batch = npids / (jobs * 4);
+    if (job.batch < 1) {job.batch = 1;}
+    if (job.batch > PID_BATCH) {job.batch = PID_BATCH;}
+    job.nbatches = (npids + job.batch - 1) / job.batch;
+    job.next_batch = 0;
+    job.batch_tables = (fdtable *)calloc(job.nbatches, sizeof(fdtable));
+    if (job.batch_tables == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    for (int b = 0; b < job.nbatches; b++) {
+        job.batch_tables[b].keyed = table->keyed;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+
+    if (jobs > job.nbatches) {jobs = job.nbatches;}
+    pthread_t *threads = (pthread_t *)malloc(jobs * sizeof(pthread_t));
+    if (threads == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+
+    // start workers, fall back to scanning on this thread if none could be created
+    int started = 0;
+    for (; started < jobs; started++) {
+        if (pthread_create(&threads[started], NULL, scan_worker, &job) != 0) {
+            break;
+        }
+    }
+    if (started == 0) {
+        scan_worker(&job);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // size the table once, then copy each batch on in order
+    STATS_START(merge_start);
+    size_t total = table->count;
+    for (int b = 0; b < job.nbatches; b++) {
+        total += job.batch_tables[b].count;
+    }
+    table_reserve(table, total);
+    for (int b = 0; b < job.nbatches; b++) {
+        fdtable *batch = &job.batch_tables[b];
+
+        // batch path ids are local, map each distinct batch path to its id in the final table
+        int *remap = (int *)malloc((batch->paths.nstrs + 1) * sizeof(int));
+        if (remap == NULL) {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        for (int id = 0; id < batch->paths.nstrs; id++) {
+            remap[id] = intern(&table->paths, batch->paths.strs[id]);
+        }
+        for (size_t i = 0; i < batch->count; i++) {
+            pidstruct *row = &table->rows[table->count++];
+            *row = batch->rows[i];
+            row->path_id = remap[row->path_id];
+        }
+        for (size_t i = 0; i < batch->nkeys; i++) {
+            watchkey *kept = &table->keys[table->nkeys++];
+            *kept = batch->keys[i];
+            kept->path_id = remap[kept->path_id];
+        }
+        free(remap);
+        table_free(batch);
+    }
+    STATS_STOP(STATS_MERGE, merge_start);
+
+    pthread_mutex_destroy(&job.lock);
+    free(threads);
+    free(job.batch_tables);
+}
+
+void *scan_worker(void *arg){
+    ///_|> descry: worker thread, takes the next batch of pids and builds that batch's own table
+    ///_|> arg: shared scanjob
+    ///_|> returning: returns NULL
+
+    // one cache per thread, shared by all the batches it scans
+    scanjob *job = (scanjob *)arg;
+    inodecache cache;
+    memset(&cache, 0, sizeof(cache));
+    while (1) {
+        pthread_mutex_lock(&job->lock);
+        int batch = job->next_batch++;
+        pthread_mutex_unlock(&job->lock);
+        if (batch >= job->nbatches) {break;}
+
+        rowsink sink;
+        memset(&sink, 0, sizeof(sink));
+        sink.table = &job->batch_tables[batch];
+        sink.cache = &cache;
+        sink.filter = job->filter;
+        sink.prev = job->prev;
+
+        int end = (batch + 1) * job->batch;
+        if (end > job->npids) {end = job->npids;}
+        for (int i = batch * job->batch; i < end; i++) {
+            loop_fd(job->pids[i], &sink);
+        }
+    }
+    cache_free(&cache);
+#ifdef FD_STATS
+    if (stats_on) {
+        pthread_mutex_lock(&stats_lock);
+        stats_add(&stats_total, &stats);
+        pthread_mutex_unlock(&stats_lock);
+    }
+#endif
+    return NULL;
+}
+
+void loop_fd(int pid, rowsink* sink){
+    //_|> descry: for each pid, find all fds, the find corresponding filename and inode. Calls emit_row to store or print it 
+    ///_|> pid: stores pid argument 
+    ///_|> sink: rowsink to pass on
+    ///_|> returning: returns nothing 
+
+    // owner and command filters only need the pid, skip it before touching its fds
+    filterstruct *filter = sink->filter;
+    if (filter_pid(filter, pid) == 0) {
+        return;
+    }
+
+    // create path
+    char file_path[PATH_BUFFER]; 
+    snprintf(file_path, sizeof(file_path), "%s/%d/fd", proc_root, pid);
+
+    // Open fds for pid, kept open so every fd below is looked up relative to it
+    STATS_START(open_start);
+    int dirfd = open(file_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    STATS_STOP(STATS_OPEN, open_start);
+    if (dirfd == -1) {
+
+        // not ours to read, or exited since /proc was listed
+        STATS_FAILED();
+        return;
+    }
+    STATS_COUNT(pids);
+
+    // each scan thread sets up its own ring the first time, and stays synchronous if that fails
+    inodecache *cache = sink->cache;
+    if (stat_engine == ENGINE_URING && cache->ring == NULL && cache->no_uring == 0) {
+        cache->ring = uring_open();
+        if (cache->ring == NULL) {cache->no_uring = 1;}
+    }
+
+    // read entries in large batches, long array keeps the buffer aligned for the entry structs
+    long dents[DENTS_BUFFER / sizeof(long)];
+    long nread;
+    while (1) {
+        STATS_START(dents_start);
+        nread = syscall(SYS_getdents64, dirfd, dents, sizeof(dents));
+        STATS_STOP(STATS_GETDENTS, dents_start);
+        if (nread <= 0) {break;}
+
+        // collect the fds of the batch, skips . and .. and fds out of --fd-range, their number range is known from the entry name alone
+        char *fds[DENTS_MAX];
+        int nfds = 0;
+        for (long pos = 0; pos < nread;) {
+            linux_dirent64 *pdp = (linux_dirent64 *)((char *)dents + pos);
+            pos += pdp->d_reclen;
+            char *fd = pdp->d_name;
+            if (fd[0] == '.') {continue;}
+            int fdnum = atoi(fd);
+            if (fdnum < filter->fd_min || (filter->fd_max != -1 && fdnum > filter->fd_max)) {continue;}
+            STATS_COUNT(fds);
+            fds[nfds++] = fd;
+        }
+
+        // stat the whole batch through the ring, or one fd at a time
+        if (cache->ring != NULL && cache->no_uring == 0) {
+            if (uring_scan(sink, pid, dirfd, fds, nfds) == -1) {
+                close(dirfd);
+                return;
+            }
+            continue;
+        }
+        for (int i = 0; i < nfds; i++) {
+
+            // find the open file once through the fd entry itself, then reuse its filename if another fd already resolved it
+            inodekey key;
+            mode_t mode = 0;
+            STATS_START(stat_start);
+            int stat_return = stat_fd(cache, dirfd, fds[i], &key, &mode);
+            STATS_STOP(STATS_STAT, stat_start);
+            if (resolve_fd(sink, pid, dirfd, fds[i], stat_return, &key, mode) == -1) {
+                close(dirfd);
+                return;
+            }
+        }
+    }
+
+    close(dirfd);
+}
+
+int resolve_fd(rowsink* sink, int pid, int dirfd, char *fd, int stat_return, inodekey* key, mode_t mode){
+    //_|> descry: finds the filename and inode of one stat'ed fd, from the cache or a readlink, and emits its row
+    //_|> sink: rowsink to pass on
+    //_|> pid: pid of the fd
+    //_|> dirfd: open /proc/<pid>/fd directory
+    //_|> fd: fd entry name
+    //_|> stat_return, key, mode: result of the stat, stat_return 0 on success
+    ///_|> returning: returns 0 to go on with the next fd, -1 to stop scanning the pid
+
+    filterstruct *filter = sink->filter;
+    inodekey *cached = NULL;
+    if (stat_return == 0) {
+
+        // type is known from the stat, skip the readlink for fds of other types
+        if (filter->types != 0 && (fd_type(stat_return, mode, NULL) & filter->types) == 0) {return 0;}
+
+        // --watch, the same pid and fd on the same mount, device and inode as in the last scan keeps its last name
+        if (sink->prev != NULL) {
+            watchkey *seen = key_find(sink->prev, pid, (int)strtol(fd, NULL, 10));
+            if (seen != NULL && seen->mnt == key->mnt && seen->dev == key->dev && seen->ino == key->ino) {
+                STATS_COUNT(cache_hits);
+                const char *seen_name = sink->prev->paths.strs[seen->path_id];
+                if (filter_path(filter, seen_name) == 1) {
+                    emit_row(sink, pid, fd, seen_name, seen->inode);
+                    keep_key(sink, key);
+                }
+                return 0;
+            }
+        }
+
+        // only sockets and pipes can have a cached name, files are always readlink'ed
+        if (S_ISSOCK(mode) || S_ISFIFO(mode)) {cached = cache_find(sink->cache, key);}
+        if (cached != NULL && cached->name_id != 0) {
+            STATS_COUNT(cache_hits);
+            const char *cached_name = sink->cache->names.strs[cached->name_id - 1];
+            if (filter_path(filter, cached_name) == 1) {
+                emit_row(sink, pid, fd, cached_name, (long)key->ino);
+                keep_key(sink, key);
+            }
+            return 0;
+        }
+    }
+
+    // Find file_name
+    char file_name[1000] = {"\0"};
+    STATS_START(link_start);
+    ssize_t link_return = readlinkat(dirfd, fd, file_name, sizeof(file_name) - 1);
+    STATS_STOP(STATS_READLINK, link_start);
+    if (link_return != -1){
+
+        //readlink does not null terminate
+        file_name[link_return] = '\0'; 
+    } else {
+
+        // Cannot access file_name, create pid and fd pair only, unless filtering on what it is
+        STATS_FAILED();
+        if (filter->types == 0 && filter->path_prefix == NULL) {
+            emit_row(sink, pid, fd, "None", -1);
+        }
+        return -1;
+    }
+
+    // anon inodes all share one kernel inode, show as 0
+    long inode;
+    if ((mode & S_IFMT) == 0 && strncmp(file_name, "anon_inode:", 11) == 0) {
+        inode = 0;
+    } else if (stat_return == 0) {
+        inode = (long)key->ino;
+
+        // socket:[N] and pipe:[N] are named after their inode, a file's name depends on the fd (hard links, chroots, renames)
+        if (cached != NULL && (strncmp(file_name, "socket:[", 8) == 0 || strncmp(file_name, "pipe:[", 6) == 0)) {
+            *cached = *key;
+            cached->name_id = intern(&sink->cache->names, file_name) + 1;
+            sink->cache->nused++;
+        }
+    } else {
+
+        // fd closed between the stat and readlink, fall back to the inode in a type:[inode] name
+        inode = parse_link_inode(file_name);
+    }
+
+    // without a stat the type comes from the name
+    if (stat_return != 0 && filter->types != 0 && (fd_type(stat_return, mode, file_name) & filter->types) == 0) {return 0;}
+    if (filter_path(filter, file_name) == 0) {return 0;}
+
+    //add entry to table or print it
+    emit_row(sink, pid, fd, file_name, inode);
+    if (stat_return == 0) {keep_key(sink, key);}
+    return 0;
+}
+
+int filter_pid(filterstruct* filter, int pid){
+    //_|> descry: checks the owner uid and command name filters for a pid
+    //_|> filter: row filters
+    //_|> pid: pid to check
+    ///_|> returning: returns 1 to scan the pid, 0 to skip it
+
+    if (filter->uid == -1 && filter->comm == NULL) {return 1;}
+    STATS_START(start);
+    int keep = 1;
+    char proc_path[PATH_BUFFER];
+    if (filter->uid != -1) {
+        struct stat sb;
+        snprintf(proc_path, sizeof(proc_path), "%s/%d", proc_root, pid);
+        if (stat(proc_path, &sb) != 0 || (int)sb.st_uid != filter->uid) {keep = 0;}
+    }
+    if (keep == 1 && filter->comm != NULL) {
+        char comm[64];
+        if (read_comm(pid, comm, sizeof(comm)) != 0 || strcmp(comm, filter->comm) != 0) {keep = 0;}
+    }
+    STATS_STOP(STATS_FILTER, start);
+    return keep;
+}
+
+int fd_type(int stat_return, mode_t mode, const char *file_name){
+    //_|> descry: finds what kind of file an fd is, from its stat mode or else from its link name
+    //_|> stat_return: 0 if mode is valid
+    //_|> mode: stat mode of the open file
+    //_|> file_name: link name, NULL if not read yet
+    ///_|> returning: returns one TYPE_ bit, 0 if unknown
+
+    if (stat_return == 0) {
+        if (S_ISSOCK(mode)) {return TYPE_SOCKET;}
+        if (S_ISFIFO(mode)) {return TYPE_PIPE;}
+        if ((mode & S_IFMT) == 0) {return TYPE_ANON;}
+        return TYPE_FILE;
+    }
+    if (file_name == NULL) {return 0;}
+    if (strncmp(file_name, "socket:", 7) == 0) {return TYPE_SOCKET;}
+    if (strncmp(file_name, "pipe:", 5) == 0) {return TYPE_PIPE;}
+    if (strncmp(file_name, "anon_inode:", 11) == 0) {return TYPE_ANON;}
+    return TYPE_FILE;
+}
+
+int filter_path(filterstruct* filter, const char *file_name){
+    //_|> descry: checks the path prefix filter
+    //_|> filter: row filters
+    //_|> file_name: filename of the fd
+    ///_|> returning: returns 1 to keep the row, 0 to drop it
+
+    if (filter->path_prefix == NULL) {return 1;}
+    return strncmp(file_name, filter->path_prefix, strlen(filter->path_prefix)) == 0;
+}
+
+void emit_row(rowsink* sink, int pid, char *fd, const char *file_name, long inode){
+    //_|> descry: hands one row to the sink, either appending it to the table or printing and counting it right away
+    //_|> sink: where the row goes
+    //_|> pid, fd, file_name, inode: row vals
+    ///_|> returning: returns nothing
+
+    if (sink->stream == 0) {
+        STATS_START(node_start);
+        create_node(pid, fd, file_name, inode, sink->table);
+        STATS_STOP(STATS_NODE, node_start);
+        return;
+    }
+
+    STATS_START(output_start);
+    int fdnum = (int)strtol(fd, NULL, 10);
+    for (int table_type = 1; table_type <= FORMAT_NDJSON; table_type++) {
+        if (sink->show[table_type] == 1) {print_row(sink->out, table_type, pid, fdnum, file_name, inode, sink->net);}
+    }
+    if (sink->txt != NULL) {output_row(sink->txt, pid, fdnum, file_name, inode);}
+    if (sink->snap != NULL) {create_node(pid, fd, file_name, inode, sink->snap);}
+    if (sink->countmap != NULL) {summary_count(pid, sink->countmap);}
+    if (sink->top != NULL) {top_count(sink->top, pid, file_name);}
+    if (sink->by != NULL) {group_count(sink->by, pid);}
+    STATS_STOP(STATS_OUTPUT, output_start);
+}
+
+int stat_fd(inodecache* cache, int dirfd, const char *fd, inodekey* key, mode_t* mode){
+    //_|> descry: stats the open file behind an fd entry, with statx so the mount id is known, or fstatat on kernels without it
+    //_|> cache: inodecache, remembers when statx is missing
+    //_|> dirfd: open /proc/<pid>/fd directory
+    //_|> fd: fd entry name
+    //_|> key: filled with the mount, device and inode
+    //_|> mode: filled with the file type and mode
+    ///_|> returning: returns 0 on success, -1 on error
+
+    memset(key, 0, sizeof(inodekey));
+    if (cache->no_statx == 0) {
+        struct statx stx;
+        if (statx(dirfd, fd, 0, STATX_TYPE | STATX_INO | STATX_MNT_ID, &stx) == 0) {
+            statx_key(&stx, key, mode);
+            return 0;
+        }
+        if (errno != ENOSYS) {return -1;}
+        cache->no_statx = 1;
+    }
+
+    struct stat sb;
+    if (fstatat(dirfd, fd, &sb, 0) != 0) {return -1;}
+    key->dev = sb.st_dev;
+    key->ino = sb.st_ino;
+    *mode = sb.st_mode;
+    return 0;
+}
+
+void statx_key(struct statx* stx, inodekey* key, mode_t* mode){
+    //_|> descry: fills an inodekey and mode from a statx result
+    //_|> stx: statx result
+    //_|> key: filled with the mount, device and inode
+    //_|> mode: filled with the file type and mode
+    ///_|> returning: returns nothing
+
+    key->dev = ((uint64_t)stx->stx_dev_major << 32) | stx->stx_dev_minor;
+    key->ino = stx->stx_ino;
+    key->mnt = (stx->stx_mask & STATX_MNT_ID) ? stx->stx_mnt_id + 1 : 0;
+    key->name_id = 0;
+    *mode = stx->stx_mode;
+}
+
+int uring_scan(rowsink* sink, int pid, int dirfd, char **fds, int nfds){
+    //_|> descry: --engine=uring, keeps up to URING_DEPTH statx of the batch queued so slow filesystems answer them in parallel, then resolves the fds in order as their stats complete
+    //_|> sink: rowsink to pass on, its cache holds the ring
+    //_|> pid: pid of the fds
+    //_|> dirfd: open /proc/<pid>/fd directory
+    //_|> fds: fd entry names of one getdents64 batch
+    //_|> nfds: number of fds
+    ///_|> returning: returns 0 when done, -1 to stop scanning the pid; nothing is left in flight either way
+
+    uring *ring = sink->cache->ring;
+    int queued = 0, stop = 0;
+    for (int i = 0; i < nfds; i++) {
+
+        // top the window back up once half of it is used, so requests go in with few io_uring_enter calls
+        if (stop == 0 && queued < nfds && queued - i <= URING_DEPTH / 2) {
+            unsigned tail = *ring->sq_tail;
+            for (; queued < nfds && queued - i < URING_DEPTH; queued++) {
+                int slot = queued % URING_DEPTH;
+                struct io_uring_sqe *sqe = &ring->sqes[tail & ring->sq_mask];
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_STATX;
+                sqe->fd = dirfd;
+                sqe->addr = (uint64_t)(uintptr_t)fds[queued];
+                sqe->len = STATX_TYPE | STATX_INO | STATX_MNT_ID;
+                sqe->off = (uint64_t)(uintptr_t)&ring->stx[slot];
+                sqe->user_data = (uint64_t)slot;
+                ring->sq_array[tail & ring->sq_mask] = tail & ring->sq_mask;
+                ring->done[slot] = 0;
+                tail++;
+                ring->pending++;
+            }
+            __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+        }
+
+        // fds are resolved in order, wait until this one's stat is in
+        int slot = i % URING_DEPTH;
+        while (ring->done[slot] == 0) {
+            STATS_START(stat_start);
+            uring_wait(ring, 1);
+            STATS_STOP(STATS_STAT, stat_start);
+        }
+        if (stop == 1) {continue;}
+
+        // statx ops missing from the ring, this fd and every later batch stat synchronously
+        inodekey key;
+        mode_t mode = 0;
+        int stat_return = 0;
+        if (ring->res[slot] == -EINVAL || ring->res[slot] == -EOPNOTSUPP) {
+            sink->cache->no_uring = 1;
+            stat_return = stat_fd(sink->cache, dirfd, fds[i], &key, &mode);
+        } else if (ring->res[slot] < 0) {
+            memset(&key, 0, sizeof(key));
+            stat_return = -1;
+        } else {
+            statx_key(&ring->stx[slot], &key, &mode);
+        }
+
+        // stopping still waits out what was queued, the requests point into this batch
+        if (resolve_fd(sink, pid, dirfd, fds[i], stat_return, &key, mode) == -1) {
+            stop = 1;
+            nfds = queued;
+        }
+    }
+    return stop == 1 ? -1 : 0;
+}
+
+void uring_wait(uring* ring, int wait){
+    //_|> descry: submits queued requests and collects the completions that are in, marking their slots done
+    //_|> ring: uring
+    //_|> wait: 1 to block until at least one completion is in
+    ///_|> returning: returns nothing
+
+    unsigned submit = *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (submit > 0 || wait == 1) {
+        unsigned flags = wait == 1 ? IORING_ENTER_GETEVENTS : 0;
+        if (syscall(__NR_io_uring_enter, ring->fd, submit, wait, flags, NULL, 0) == -1 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            fprintf(stderr, "io_uring_enter failed\n");
+            exit(1);
+        }
+    }
+
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+        int slot = (int)cqe->user_data;
+        ring->res[slot] = cqe->res;
+        ring->done[slot] = 1;
+        ring->pending--;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+uring *uring_open(void){
+    //_|> descry: sets up an io_uring of URING_DEPTH entries and maps its rings
+    ///_|> returning: returns the uring, NULL if io_uring is not available
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ring_fd = (int)syscall(__NR_io_uring_setup, URING_DEPTH, &params);
+    if (ring_fd == -1) {return NULL;}
+    uring *ring = (uring *)calloc(1, sizeof(uring));
+    if (ring == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    ring->fd = ring_fd;
+
+    // one mapping serves both rings on kernels that allow it
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_size > ring->sq_size) {ring->sq_size = ring->cq_size;}
+        ring->cq_size = ring->sq_size;
+    }
+    ring->sq_map = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    ring->cq_map = MAP_FAILED;
+    if (ring->sq_map != MAP_FAILED) {
+        ring->cq_map = (params.features & IORING_FEAT_SINGLE_MMAP) ? ring->sq_map : mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = MAP_FAILED;
+    if (ring->cq_map != MAP_FAILED) {
+        ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    }
+    if (ring->sqes == MAP_FAILED) {
+        uring_close(ring);
+        return NULL;
+    }
+
+    char *sq = (char *)ring->sq_map, *cq = (char *)ring->cq_map;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return ring;
+}
+
+void uring_close(uring* ring){
+    //_|> descry: unmaps the rings and closes the io_uring, waiting out anything still in flight
+    //_|> ring: uring to close, may be NULL
+    ///_|> returning: returns nothing
+
+    if (ring == NULL) {return;}
+    if (ring->sqes != NULL && ring->sqes != MAP_FAILED) {
+        while (ring->pending > 0) {
+            uring_wait(ring, 1);
+        }
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_map != NULL && ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map) {munmap(ring->cq_map, ring->cq_size);}
+    if (ring->sq_map != NULL && ring->sq_map != MAP_FAILED) {munmap(ring->sq_map, ring->sq_size);}
+    close(ring->fd);
+    free(ring);
+}
+
+inodekey *cache_find(inodecache* cache, inodekey* key){
+    //_|> descry: finds the cache slot for key, the slot has name_id 0 when the file has not been resolved yet
+    //_|> cache: inodecache to search
+    //_|> key: mount, device and inode to look for
+    ///_|> returning: returns the matching or empty slot
+
+    // start over once full so a scan of many distinct sockets and pipes does not grow without bound
+    if (cache->nused >= CACHE_MAX) {
+        inodecache keep = *cache;
+        cache->ring = NULL;
+        cache_free(cache);
+        cache->no_statx = keep.no_statx;
+        cache->ring = keep.ring;
+        cache->no_uring = keep.no_uring;
+    }
+
+    // keep load under half so probes stay short
+    if ((cache->nused + 1) * 2 > cache->nslots) {
+        cache_grow(cache);
+    }
+
+    unsigned int mask = (unsigned int)cache->nslots - 1;
+    uint64_t hash = (key->ino ^ (key->dev << 17) ^ (key->mnt << 41)) * 0x9E3779B97F4A7C15ull;
+    unsigned int slot = (unsigned int)(hash >> 32) & mask;
+    while (cache->slots[slot].name_id != 0) {
+        inodekey *curr = &cache->slots[slot];
+        if (curr->ino == key->ino && curr->dev == key->dev && curr->mnt == key->mnt) {
+            return curr;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return &cache->slots[slot];
+}
+
+void cache_grow(inodecache* cache){
+    //_|> descry: doubles the inodecache slots and rehashes the resolved files
+    //_|> cache: inodecache to grow
+    ///_|> returning: returns nothing
+
+    inodecache old = *cache;
+    cache->nslots = old.nslots == 0 ? CACHE_START : old.nslots * 2;
+    cache->slots = (inodekey *)calloc(cache->nslots, sizeof(inodekey));
+    if (cache->slots == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    cache->nused = 0;
+    for (int i = 0; i < old.nslots; i++) {
+        if (old.slots[i].name_id != 0) {
+            *cache_find(cache, &old.slots[i]) = old.slots[i];
+            cache->nused++;
+        }
+    }
+    free(old.slots);
+}
+
+void cache_free(inodecache* cache){
+    //_|> descry: frees the inodecache slots, cached filenames and io_uring
+    //_|> cache: inodecache to free
+    ///_|> returning: returns nothing
+
+    uring_close(cache->ring);
+    cache->ring = NULL;
+    free(cache->slots);
+    cache->slots = NULL;
+    cache->nslots = 0;
+    cache->nused = 0;
+    intern_free(&cache->names);
+}
+
+long parse_link_inode(const char *file_name){
+    //_|> descry: reads the inode out of a socket:[inode] or pipe:[inode] style filename, the whole name has to be type:[digits]
+    //_|> file_name: link target
+    ///_|> returning: returns the inode, -1 if the name has none, like a path that only contains brackets
+
+    const char *colon = strchr(file_name, ':');
+    if (file_name[0] == '/' || colon == NULL || colon == file_name || colon[1] != '[' || !isdigit((unsigned char)colon[2])) {return -1;}
+    char *end;
+    long inode = strtol(colon + 2, &end, 10);
+    if (end[0] != ']' || end[1] != '\0') {return -1;}
+    return inode;
+}
+
+
+void print_table(fdtable* table, int table_type, netinfo* net){
+    ///_|> descry: loops through fdtable rows to print per-process systemwide vnode or composite table, or the rows as csv, json or ndjson, given table_type
+    ///_|> table: fdtable of all rows
+    ///_|> table_type: stores which table to print
+    ///_|> net: socket tables, NULL when --sockets is off
+    ///_|> returning: returns nothing 
+
+    //print header
+    print_header(table_type);
+
+    // rows go through one large buffer straight to stdout, so stdio has to be empty first
+    fflush(stdout);
+    outwriter out;
+    out_init(&out, STDOUT_FILENO);
+    for (size_t i = 0; i < table->count; i++) {
+        pidstruct* curr = &table->rows[i];
+        print_row(&out, table_type, curr->node_pid, curr->fd, row_path(table, curr), curr->inode, net);
+    }
+    out_free(&out);
+    print_footer(table_type);
+}
+
+void print_row(outwriter* out, int table_type, int pid, int fd, const char *file_name, long inode, netinfo* net){
+    ///_|> descry: writes one row of the per-process systemwide vnode or composite table, or one csv line or json object
+    ///_|> out: buffered writer
+    ///_|> table_type: stores which table to print
+    ///_|> pid, fd, file_name, inode: row vals
+    ///_|> net: socket tables, socket rows of the systemwide and composite table are described from them
+    ///_|> returning: returns nothing 
+
+    //print vals
+    char desc[160];
+    int known = strcmp("None", file_name) != 0;
+    if (table_type == 1){
+        out_str(out, "         "); out_long(out, pid); out_str(out, "       "); out_long(out, fd); out_str(out, "\n");
+    } else if (table_type == 2 && known){
+        out_str(out, "         "); out_long(out, pid); out_str(out, "     "); out_long(out, fd);
+        out_str(out, "       "); out_str(out, file_name); out_str(out, sock_desc(net, file_name, inode, desc, sizeof(desc))); out_str(out, "\n");
+    } else if (table_type == 3){
+        out_str(out, "         "); out_long(out, fd); out_str(out, "      "); out_long(out, inode); out_str(out, "\n");
+    } else if (table_type == 4 && known){
+        out_str(out, "       "); out_long(out, pid); out_str(out, "        "); out_long(out, fd);
+        out_str(out, "       "); out_str(out, file_name); out_str(out, "     "); out_long(out, inode);
+        out_str(out, sock_desc(net, file_name, inode, desc, sizeof(desc))); out_str(out, "\n");
+    } else if (table_type == FORMAT_CSV){
+
+        // unreadable fds have empty filename and inode
+        out_long(out, pid); out_str(out, ","); out_long(out, fd); out_str(out, ",");
+        if (known) {out_csv(out, file_name); out_str(out, ","); out_long(out, inode);}
+        else {out_str(out, ",");}
+        out_str(out, "\n");
+    } else if (table_type == FORMAT_JSON || table_type == FORMAT_NDJSON){
+
+        // json rows are separated by commas, ndjson rows are one per line
+        if (table_type == FORMAT_JSON && out->rows++ > 0) {out_str(out, ",\n");}
+        out_str(out, "{\"pid\":"); out_long(out, pid); out_str(out, ",\"fd\":"); out_long(out, fd);
+        if (known) {
+            out_str(out, ",\"filename\":"); out_json(out, file_name); out_str(out, ",\"inode\":"); out_long(out, inode);
+        } else {
+            out_str(out, ",\"filename\":null,\"inode\":null");
+        }
+        out_str(out, table_type == FORMAT_JSON ? "}" : "}\n");
+    }
+}
+
+void print_header(int table_type){
+    //_|> descry: helper function to print header
+    ///_|> table_type: stores table type
+    ///_|> returning: returns nothing 
+
+    switch (table_type) {
+        case 1:
+            printf("         PID    FD \n");
+            printf("        ========================================================\n");
+          break;
+        case 2:
+            printf("         PID    FD      Filename \n");  
+            printf("        ========================================================\n");
+            break;
+        case 3:
+            printf("         FD     Inode\n");
+            printf("        ========================================================\n");
+          break;
+        case 4:
+              printf("         PID    FD      Filename       Inode\n");
+            printf("        ========================================================\n");
+          break;
+        case FORMAT_CSV:
+            printf("pid,fd,filename,inode\n");
+            break;
+        case FORMAT_JSON:
+            printf("[\n");
+            break;
+      }
+    }  
+
+void print_footer(int table_type){
+    //_|> descry: helper function to print the line closing a table
+    ///_|> table_type: stores table type
+    ///_|> returning: returns nothing 
+
+    if (table_type <= 4) {
+        printf("       ========================================================\n");
+    } else if (table_type == FORMAT_JSON) {
+        printf("\n]\n");
+    }
+}
+
+void out_init(outwriter* out, int fd){
+    //_|> descry: starts a buffered writer on an open fd
+    //_|> out: writer to start
+    //_|> fd: fd to write to, not closed by the writer
+    ///_|> returning: returns nothing
+
+    out->fd = fd;
+    out->used = 0;
+    out->rows = 0;
+    out->failed = 0;
+    out->buf = (char *)malloc(OUT_BUFFER);
+    if (out->buf == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+}
+
+void out_bytes(outwriter* out, const char *str, size_t len){
+    //_|> descry: appends bytes to the buffer, writing it out whenever it fills
+    //_|> out: writer
+    //_|> str: bytes to append
+    //_|> len: number of bytes
+    ///_|> returning: returns nothing
+
+    while (len > OUT_BUFFER - out->used) {
+        size_t room = OUT_BUFFER - out->used;
+        memcpy(out->buf + out->used, str, room);
+        out->used += room;
+        str += room;
+        len -= room;
+        out_flush(out);
+    }
+    memcpy(out->buf + out->used, str, len);
+    out->used += len;
+}
+
+void out_str(outwriter* out, const char *str){
+    //_|> descry: appends a null terminated string
+    //_|> out: writer
+    //_|> str: string to append
+    ///_|> returning: returns nothing
+
+    out_bytes(out, str, strlen(str));
+}
+
+void out_long(outwriter* out, long val){
+    //_|> descry: appends a number in decimal, without going through printf
+    //_|> out: writer
+    //_|> val: number to append
+    ///_|> returning: returns nothing
+
+    char digits[24];
+    char *pos = digits + sizeof(digits);
+    unsigned long mag = val < 0 ? 0 - (unsigned long)val : (unsigned long)val;
+    do {
+        *--pos = (char)('0' + mag % 10);
+        mag /= 10;
+    } while (mag != 0);
+    if (val < 0) {*--pos = '-';}
+    out_bytes(out, pos, digits + sizeof(digits) - pos);
+}
+
+void out_csv(outwriter* out, const char *str){
+    //_|> descry: appends a csv field, quoted with inner quotes doubled when it holds a comma, quote or line break
+    //_|> out: writer
+    //_|> str: field to append
+    ///_|> returning: returns nothing
+
+    if (str[strcspn(str, ",\"\r\n")] == '\0') {
+        out_str(out, str);
+        return;
+    }
+    out_bytes(out, "\"", 1);
+    for (const char *quote; (quote = strchr(str, '"')) != NULL; str = quote + 1) {
+        out_bytes(out, str, quote - str + 1);
+        out_bytes(out, "\"", 1);
+    }
+    out_str(out, str);
+    out_bytes(out, "\"", 1);
+}
+
+void out_json(outwriter* out, const char *str){
+    //_|> descry: appends a json string, escaping quotes, backslashes and control characters, a byte that is not valid utf-8 is written as \u00XX
+    //_|> out: writer
+    //_|> str: string to append
+    ///_|> returning: returns nothing
+
+    static const char hex[] = "0123456789abcdef";
+    out_bytes(out, "\"", 1);
+    const unsigned char *pos = (const unsigned char *)str;
+    const unsigned char *run = pos;
+    while (*pos != '\0') {
+
+        // runs of plain ascii and whole utf-8 sequences are copied as they are
+        size_t len = utf8_len(pos);
+        if (len > 1 || (len == 1 && *pos >= 0x20 && *pos != '"' && *pos != '\\')) {
+            pos += len;
+            continue;
+        }
+        out_bytes(out, (const char *)run, pos - run);
+        char esc[7] = {'\\', 'u', '0', '0', hex[*pos >> 4], hex[*pos & 15], '\0'};
+        if (*pos == '"') {out_bytes(out, "\\\"", 2);}
+        else if (*pos == '\\') {out_bytes(out, "\\\\", 2);}
+        else if (*pos == '\n') {out_bytes(out, "\\n", 2);}
+        else if (*pos == '\t') {out_bytes(out, "\\t", 2);}
+        else {out_bytes(out, esc, 6);}
+        run = ++pos;
+    }
+    out_bytes(out, (const char *)run, pos - run);
+    out_bytes(out, "\"", 1);
+}
+
+size_t utf8_len(const unsigned char *pos){
+    //_|> descry: finds the length of the utf-8 sequence starting at pos
+    //_|> pos: first byte of the sequence
+    ///_|> returning: returns 1 to 4, or 0 if the bytes are not a valid sequence
+
+    if (*pos < 0x80) {return 1;}
+    size_t len = (*pos & 0xE0) == 0xC0 ? 2 : (*pos & 0xF0) == 0xE0 ? 3 : (*pos & 0xF8) == 0xF0 ? 4 : 0;
+    if (len == 0 || (len == 2 && *pos < 0xC2) || *pos > 0xF4) {return 0;}
+    for (size_t i = 1; i < len; i++) {
+        if ((pos[i] & 0xC0) != 0x80) {return 0;}
+    }
+
+    // overlong three and four byte forms, surrogates and code points past U+10FFFF
+    if (len == 3 && ((*pos == 0xE0 && pos[1] < 0xA0) || (*pos == 0xED && pos[1] >= 0xA0))) {return 0;}
+    if (len == 4 && ((*pos == 0xF0 && pos[1] < 0x90) || (*pos == 0xF4 && pos[1] >= 0x90))) {return 0;}
+    return len;
+}
+
+void out_flush(outwriter* out){
+    //_|> descry: writes the buffer out with as few write calls as the fd allows
+    //_|> out: writer
+    ///_|> returning: returns nothing
+
+    size_t done = 0;
+    while (done < out->used && out->failed == 0) {
+        ssize_t wrote = write(out->fd, out->buf + done, out->used - done);
+        STATS_COUNT(writes);
+        if (wrote == -1 && errno == EINTR) {continue;}
+        if (wrote <= 0) {
+            fprintf(stderr, "Error writing output\n");
+            out->failed = 1;
+            break;
+        }
+        done += wrote;
+    }
+    out->used = 0;
+}
+
+void out_free(outwriter* out){
+    //_|> descry: flushes what is left and frees the buffer, the fd stays open
+    //_|> out: writer
+    ///_|> returning: returns nothing
+
+    out_flush(out);
+    free(out->buf);
+    out->buf = NULL;
+}
+
+void parse_arguments(int argc, char *argv[], int *per_process, int *systemWide, int *Vnodes, int *composite, int *format, int *summary, int *threshold, pidselect *sel, int* output_txt, int* output_b, int *jobs, int *stream, int *sockets, char **holders, char **load, char **archive, char **at, double *watch, double *leaks, topheap *top, groupby *by, filterstruct *filter)
+{
+    //_|> descry: processes all argument and updates pointers in main
+    //_|> argc: argument count
+    //_|> argv: input
+    //_|> per_process: per-process flag
+    //_|> systemWide: systemWide flag
+    //_|> Vnodes: vnodes flag
+    //_|> composite: composite flag
+    //_|> format: table type of the composite table, 4 or a FORMAT_ type
+    //_|> summary: summary flag
+    //_|> threshold: threshold value
+    //_|> sel: pid, pid range, name and regex selectors, and --children
+    //_|> output_txt: output ascii file flag
+    //_|> output_b: output binary file flag
+    //_|> jobs: number of scan threads, 0 means one per online cpu
+    //_|> stream: stream rows flag
+    //_|> sockets: describe socket rows from /proc/net flag
+    //_|> holders: filename or inode to list the holders of
+    //_|> load: snapshot or archive to read the table from instead of scanning
+    //_|> archive: archive to append this scan to
+    //_|> at: time of the archived snapshot to load, latest if NULL
+    //_|> watch: seconds between --watch rescans, 0 for a single scan
+    //_|> leaks: seconds between --leaks samples, 0 for none
+    //_|> top: k and fd types of the --top ranking, k 0 for none
+    //_|> by: --by views, nviews 0 for none
+    //_|> filter: uid, user, comm, type, path prefix and fd range filters
+    ///_|> returning: returns nothing 
+
+    int arg_num = 1;
+    for (; arg_num < argc; arg_num++)
+    {
+        if (isdigit(argv[arg_num][0])){parse_selector(argv[arg_num], sel);}
+        else if (strncmp(argv[arg_num], "--name=", 7) == 0 || strncmp(argv[arg_num], "--match=", 8) == 0){
+            if (argv[arg_num][2] == 'n') {
+                char **grown = (char **)realloc(sel->names, (sel->nnames + 1) * sizeof(char *));
+                if (grown == NULL) {
+                    fprintf(stderr, "Insufficient memory");
+                    exit(1);
+                }
+                sel->names = grown;
+                sel->names[sel->nnames++] = argv[arg_num] + 7;
+            } else {
+                regex_t *grown = (regex_t *)realloc(sel->regexes, (sel->nregexes + 1) * sizeof(regex_t));
+                if (grown == NULL) {
+                    fprintf(stderr, "Insufficient memory");
+                    exit(1);
+                }
+                sel->regexes = grown;
+                if (regcomp(&sel->regexes[sel->nregexes], argv[arg_num] + 8, REG_EXTENDED | REG_NOSUB) != 0) {
+                    fprintf(stderr, "Arguments incorrect\n");
+                    exit(1);
+                }
+                sel->nregexes++;
+            }
+        }
+        else if (strcmp(argv[arg_num], "--children") == 0){sel->children = 1;}
+        else if (strcmp(argv[arg_num], "--per-process") == 0){*per_process = 1;}
+        else if (strcmp(argv[arg_num], "--systemWide") == 0){*systemWide = 1;}
+        else if (strcmp(argv[arg_num], "--Vnodes") == 0){*Vnodes = 1;}
+        else if (strcmp(argv[arg_num], "--composite") == 0){*composite = 1;}
+        else if (strcmp(argv[arg_num], "--summary") == 0){*summary = 1;}
+        else if (strncmp(argv[arg_num], "--format=", 9) == 0){
+
+            // a format on its own is the composite table in that format
+            if (strcmp(argv[arg_num] + 9, "csv") == 0) {*format = FORMAT_CSV;}
+            else if (strcmp(argv[arg_num] + 9, "json") == 0) {*format = FORMAT_JSON;}
+            else if (strcmp(argv[arg_num] + 9, "ndjson") == 0) {*format = FORMAT_NDJSON;}
+            else {
+                fprintf(stderr, "Arguments incorrect\n");
+                exit(1);
+            }
+            *composite = 1;
+        }
+        else if (strncmp(argv[arg_num], "--threshold=", 12) == 0){*threshold = atoi(argv[arg_num] + 12);}
+        else if (strcmp(argv[arg_num], "--output_TXT") == 0){*output_txt = 1;}
+        else if (strcmp(argv[arg_num], "--output_binary") == 0){*output_b = 1; } 
+        else if (strncmp(argv[arg_num], "--jobs=", 7) == 0){*jobs = atoi(argv[arg_num] + 7);}
+        else if (strcmp(argv[arg_num], "--stream") == 0){*stream = 1;}
+        else if (strcmp(argv[arg_num], "--sockets") == 0){*sockets = 1;}
+        else if (strncmp(argv[arg_num], "--holders=", 10) == 0){*holders = argv[arg_num] + 10;}
+        else if (strncmp(argv[arg_num], "--load=", 7) == 0){*load = argv[arg_num] + 7;}
+        else if (strncmp(argv[arg_num], "--archive=", 10) == 0){*archive = argv[arg_num] + 10;}
+        else if (strncmp(argv[arg_num], "--at=", 5) == 0){*at = argv[arg_num] + 5;}
+        else if (strncmp(argv[arg_num], "--leaks=", 8) == 0){
+            *leaks = strtod(argv[arg_num] + 8, NULL);
+            if (*leaks <= 0) {
+                fprintf(stderr, "Arguments incorrect\n");
+                exit(1);
+            }
+        }
+        else if (strncmp(argv[arg_num], "--top=", 6) == 0){
+
+            // K, or K,type,... to rank by fds of those types only
+            char *end;
+            top->k = (int)strtol(argv[arg_num] + 6, &end, 10);
+            if (top->k <= 0 || (*end != '\0' && *end != ',')) {
+                fprintf(stderr, "Arguments incorrect\n");
+                exit(1);
+            }
+            if (*end == ',') {
+                top->label = end + 1;
+                char *types = strdup(end + 1);
+                if (types == NULL) {
+                    fprintf(stderr, "Insufficient memory");
+                    exit(1);
+                }
+                top->types = parse_types(types);
+                free(types);
+            }
+        }
+        else if (strncmp(argv[arg_num], "--by=", 5) == 0){parse_groups(argv[arg_num] + 5, by);}
+        else if (strncmp(argv[arg_num], "--proc-root=", 12) == 0){proc_root = argv[arg_num] + 12;}
+        else if (strcmp(argv[arg_num], "--engine=sync") == 0){stat_engine = ENGINE_SYNC;}
+        else if (strcmp(argv[arg_num], "--engine=uring") == 0){stat_engine = ENGINE_URING;}
+        else if (strcmp(argv[arg_num], "--stats") == 0){
+#ifdef FD_STATS
+            stats_on = 1;
+#else
+            fprintf(stderr, "--stats needs a build with STATS=1\n");
+            exit(1);
+#endif
+        }
+        else if (strncmp(argv[arg_num], "--watch=", 8) == 0){
+            *watch = strtod(argv[arg_num] + 8, NULL);
+            if (*watch <= 0) {
+                fprintf(stderr, "Arguments incorrect\n");
+                exit(1);
+            }
+        }
+        else if (strncmp(argv[arg_num], "--uid=", 6) == 0){filter->uid = atoi(argv[arg_num] + 6);}
+        else if (strncmp(argv[arg_num], "--user=", 7) == 0){
+            struct passwd *pw = getpwnam(argv[arg_num] + 7);
+            if (pw == NULL) {
+                fprintf(stderr, "Unknown user\n");
+                exit(1);
+            }
+            filter->uid = (int)pw->pw_uid;
+        }
+        else if (strncmp(argv[arg_num], "--comm=", 7) == 0){filter->comm = argv[arg_num] + 7;}
+        else if (strncmp(argv[arg_num], "--type=", 7) == 0){filter->types = parse_types(argv[arg_num] + 7);}
+        else if (strncmp(argv[arg_num], "--path-prefix=", 14) == 0){filter->path_prefix = argv[arg_num] + 14;}
+        else if (strncmp(argv[arg_num], "--fd-range=", 11) == 0){
+
+            // a-b, a- for no upper bound, or a single fd
+            char *pos = argv[arg_num] + 11, *end = pos;
+            long lo = isdigit((unsigned char)*pos) ? strtol(pos, &end, 10) : -1, hi = lo;
+            if (*end == '-') {
+                pos = end + 1;
+                end = pos;
+                hi = -1;
+                if (isdigit((unsigned char)*pos)) {hi = strtol(pos, &end, 10);}
+            }
+            if (lo < 0 || lo > INT_MAX || (hi != -1 && (hi < lo || hi > INT_MAX)) || *end != '\0') {
+                fprintf(stderr, "Arguments incorrect\n");
+                exit(1);
+            }
+            filter->fd_min = (int)lo;
+            filter->fd_max = (int)hi;
+        }
+        else    
+        {
+            //incorrect arguments
+            fprintf(stderr, "Arguments incorrect\n");
+            exit(1);
+        }
+    }
+
+    // jobs=0 uses every online cpu
+    if (*jobs <= 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        *jobs = ncpu > 0 ? (int)ncpu : 1;
+    }
+
+    // no arguments not including output file, print composite
+    if (*per_process == 0 && *systemWide == 0 && *Vnodes == 0 && *composite == 0 && *summary == 0 && *threshold == -1 && *holders == NULL && top->k == 0 && by->nviews == 0) {
+        *composite = 1;
+    }
+}
+
+int parse_types(char *types){
+    //_|> descry: turns a comma separated --type list into TYPE_ bits
+    //_|> types: list of file, socket, pipe, anon
+    ///_|> returning: returns the TYPE_ bits, exits on an unknown type
+
+    int bits = 0;
+    char *save;
+    for (char *type = strtok_r(types, ",", &save); type != NULL; type = strtok_r(NULL, ",", &save)) {
+        if (strcmp(type, "file") == 0) {bits |= TYPE_FILE;}
+        else if (strcmp(type, "socket") == 0) {bits |= TYPE_SOCKET;}
+        else if (strcmp(type, "pipe") == 0) {bits |= TYPE_PIPE;}
+        else if (strcmp(type, "anon") == 0) {bits |= TYPE_ANON;}
+        else {
+            fprintf(stderr, "Arguments incorrect\n");
+            exit(1);
+        }
+    }
+    return bits;
+}
+
+void create_node(int pid, char *fd, const char *file_name, long inode, fdtable* table){
+    //_|> descry: appends a row storing pid,fd,filename and inode to the fdtable
+    ///_|> pid: pid of current loop
+    //_|> fd: fd of current loop
+    //_|>filename: corresponding filename
+    //_|>inode: corresponding inode
+    //_|> table: fdtable to append to
+    ///_|> returning: returns nothing
+
+    // make room for one more row, capacity doubles so appends stay O(1)
+    table_reserve(table, table->count + 1);
+
+    //insert vals
+    pidstruct* node = &table->rows[table->count++];
+    node->node_pid = pid;
+    node->fd = (int)strtol(fd, NULL, 10 );
+    node->inode = inode;
+    node->path_id = intern(&table->paths, file_name);
+}
+
+void table_reserve(fdtable* table, size_t need){
+    //_|> descry: grows the fdtable row array so it can hold at least need rows
+    //_|> table: fdtable to grow
+    //_|> need: number of rows needed
+    ///_|> returning: returns nothing
+
+    if (need <= table->cap) {return;}
+    size_t cap = table->cap == 0 ? TABLE_START : table->cap;
+    while (cap < need) {
+        cap *= 2;
+    }
+    pidstruct* grown = (pidstruct *)realloc(table->rows, cap * sizeof(pidstruct));
+    if (grown == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    table->rows = grown;
+    if (table->keyed == 1) {
+        watchkey *keys = (watchkey *)realloc(table->keys, cap * sizeof(watchkey));
+        if (keys == NULL) {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        table->keys = keys;
+    }
+    table->cap = cap;
+}
+
+void table_free(fdtable* table){
+    //_|> descry: frees the fdtable rows and its interned filenames
+    //_|> table: fdtable to free
+    ///_|> returning: returns nothing
+
+    free(table->rows);
+    table->rows = NULL;
+    table->count = 0;
+    table->cap = 0;
+    free(table->keys);
+    table->keys = NULL;
+    table->nkeys = 0;
+    intern_free(&table->paths);
+}
+
+const char *row_path(fdtable* table, pidstruct* row){
+    //_|> descry: finds the filename a row refers to
+    //_|> table: fdtable the row belongs to
+    //_|> row: row to look up
+    ///_|> returning: returns the interned filename
+
+    return table->paths.strs[row->path_id];
+}
+
+int intern(internstruct* paths, const char *str){
+    //_|> descry: looks up str in the intern table, copying it into the arena the first time it is seen
+    //_|> paths: intern table
+    //_|> str: string to intern
+    ///_|> returning: returns the id of str
+
+    // keep load under half so probes stay short
+    if ((paths->nstrs + 1) * 2 > paths->nslots) {
+        intern_grow(paths);
+    }
+
+    // FNV-1a hash of str
+    size_t len = 0;
+    unsigned int hash = 2166136261u;
+    for (; str[len] != '\0'; len++) {
+        hash = (hash ^ (unsigned char)str[len]) * 16777619u;
+    }
+
+    // probe slots from hash, compare full strings only when hashes match
+    unsigned int mask = (unsigned int)paths->nslots - 1;
+    unsigned int slot = hash & mask;
+    while (paths->slots[slot] != 0) {
+        int id = paths->slots[slot] - 1;
+        if (paths->hashes[id] == hash && strcmp(paths->strs[id], str) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    // new string, store one copy in the arena
+    int id = paths->nstrs++;
+    paths->strs[id] = arena_copy(paths, str, len);
+    paths->hashes[id] = hash;
+    paths->slots[slot] = id + 1;
+    return id;
+}
+
+int intern_find(internstruct* paths, const char *str){
+    //_|> descry: looks up str in the intern table without adding it
+    //_|> paths: intern table
+    //_|> str: string to look for
+    ///_|> returning: returns the id of str, -1 if it was never interned
+
+    if (paths->nslots == 0) {return -1;}
+    unsigned int hash = 2166136261u;
+    for (size_t len = 0; str[len] != '\0'; len++) {
+        hash = (hash ^ (unsigned char)str[len]) * 16777619u;
+    }
+    unsigned int mask = (unsigned int)paths->nslots - 1;
+    unsigned int slot = hash & mask;
+    while (paths->slots[slot] != 0) {
+        int id = paths->slots[slot] - 1;
+        if (paths->hashes[id] == hash && strcmp(paths->strs[id], str) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+void intern_grow(internstruct* paths){
+    //_|> descry: doubles the intern table slots and id arrays, then rehashes existing strings
+    //_|> paths: intern table to grow
+    ///_|> returning: returns nothing
+
+    int nslots = paths->nslots == 0 ? INTERN_START : paths->nslots * 2;
+    int *slots = (int *)calloc(nslots, sizeof(int));
+    char **strs = (char **)realloc(paths->strs, (nslots / 2) * sizeof(char *));
+    if (strs != NULL) {paths->strs = strs;}
+    unsigned int *hashes = (unsigned int *)realloc(paths->hashes, (nslots / 2) * sizeof(unsigned int));
+    if (hashes != NULL) {paths->hashes = hashes;}
+    if (slots == NULL || strs == NULL || hashes == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+
+    // reinsert every id using its stored hash
+    unsigned int mask = (unsigned int)nslots - 1;
+    for (int id = 0; id < paths->nstrs; id++) {
+        unsigned int slot = hashes[id] & mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id + 1;
+    }
+
+    free(paths->slots);
+    paths->slots = slots;
+    paths->nslots = nslots;
+}
+
+char *arena_copy(internstruct* paths, const char *str, size_t len){
+    //_|> descry: copies str into the intern table arena, starting a new chunk when the current one is full
+    //_|> paths: intern table owning the arena
+    //_|> str: string to copy
+    //_|> len: length of str without the null
+    ///_|> returning: returns the arena copy of str
+
+    arenachunk *chunk = paths->arena;
+    if (chunk == NULL || chunk->size - chunk->used < len + 1) {
+        size_t size = len + 1 > ARENA_CHUNK ? len + 1 : ARENA_CHUNK;
+        chunk = (arenachunk *)malloc(sizeof(arenachunk) + size);
+        if (chunk == NULL) {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        chunk->used = 0;
+        chunk->size = size;
+        chunk->next = paths->arena;
+        paths->arena = chunk;
+    }
+    char *copy = chunk->data + chunk->used;
+    memcpy(copy, str, len + 1);
+    chunk->used += len + 1;
+    return copy;
+}
+
+void intern_free(internstruct* paths){
+    //_|> descry: frees the intern table and every arena chunk
+    //_|> paths: intern table to free
+    ///_|> returning: returns nothing
+
+    while (paths->arena != NULL) {
+        arenachunk *next = paths->arena->next;
+        free(paths->arena);
+        paths->arena = next;
+    }
+    free(paths->strs);
+    free(paths->hashes);
+    free(paths->slots);
+    memset(paths, 0, sizeof(internstruct));
+}
+
+void summary_list(fdtable* table, pidcountmap* countmap){
+    //_|> descry: iterates through fdtable rows and calls on summary_count to fill pidcountmap
+    ///_|> table: fdtable of all rows
+    //_|> countmap: pidcountmap to fill
+    ///_|> returning: returns nothing
+
+    //iterate through rows
+    for (size_t i = 0; i < table->count; i++){
+
+        //count num of occurrances for each pid
+        summary_count(table->rows[i].node_pid, countmap);
+    }
+}
+
+void summary_count(int pid, pidcountmap* countmap){
+    //_|> descry: looks up pid in pidcountmap hash slots, if there exists pid num count+1, else add new count for pid val
+    //_|> pid: pid of the row
+    //_|> countmap: pidcountmap to update
+    ///_|> returning: returns nothing
+
+    // keep load under half so probes stay short
+    if ((countmap->ncounts + 1) * 2 > countmap->nslots) {
+        countmap_grow(countmap);
+    }
+
+    // probe slots from pid hash
+    unsigned int mask = (unsigned int)countmap->nslots - 1;
+    unsigned int slot = ((unsigned int)pid * 2654435761u) & mask;
+    while (countmap->slots[slot] != 0) {
+
+        // if matching pid, count++
+        pidcountstruct* curr = &countmap->counts[countmap->slots[slot] - 1];
+        if (curr->node_pid == pid) {
+            curr->count += 1;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    //no matching pid, add count in first seen order
+    pidcountstruct* node = &countmap->counts[countmap->ncounts++];
+    node->node_pid = pid;
+    node->count = 1;
+    countmap->slots[slot] = countmap->ncounts;
+}
+
+void countmap_grow(pidcountmap* countmap){
+    //_|> descry: doubles the pidcountmap slots and counts, then rehashes existing pids
+    //_|> countmap: pidcountmap to grow
+    ///_|> returning: returns nothing
+
+    int nslots = countmap->nslots == 0 ? COUNT_START : countmap->nslots * 2;
+    int *slots = (int *)calloc(nslots, sizeof(int));
+    pidcountstruct* counts = (pidcountstruct *)realloc(countmap->counts, (nslots / 2) * sizeof(pidcountstruct));
+    if (slots == NULL || counts == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+
+    // reinsert every pid into the new slots
+    unsigned int mask = (unsigned int)nslots - 1;
+    for (int i = 0; i < countmap->ncounts; i++) {
+        unsigned int slot = ((unsigned int)counts[i].node_pid * 2654435761u) & mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = i + 1;
+    }
+
+    free(countmap->slots);
+    countmap->slots = slots;
+    countmap->nslots = nslots;
+    countmap->counts = counts;
+}
+
+void countmap_free(pidcountmap* countmap){
+    //_|> descry: frees the pidcountmap counts and slots
+    //_|> countmap: pidcountmap to free
+    ///_|> returning: returns nothing
+
+    free(countmap->counts);
+    free(countmap->slots);
+    countmap->counts = NULL;
+    countmap->slots = NULL;
+    countmap->ncounts = 0;
+    countmap->nslots = 0;
+}
+
+void print_summary(pidcountmap* countmap) {
+    //_|> descry: loops through pidcountmap counts to print pid and num of occurances
+    //_|> countmap: pidcountmap of all pids
+    ///_|> returning: returns nothing 
+
+    printf("         Summary Table\n");
+    printf("         =============\n");
+
+    //iterate through counts in first seen order to print 
+    for (int i = 0; i < countmap->ncounts; i++) {
+        pidcountstruct* curr = &countmap->counts[i];
+        printf("%d (%d),  ", curr->node_pid, curr->count);
+    }
+    printf("\n\n");
+}
+
+
+void print_threshold(pidcountmap* countmap, int threshold) {
+    //_|> descry: iterates through pidcountmap counts, prints threshold table by comparing threshold to count 
+    //_|> countmap: pidcountmap of all pids
+    ///_|> returning: returns nothing 
+
+    printf("## Offending processes:\n");
+
+    //iterate through counts in first seen order to print 
+    for (int i = 0; i < countmap->ncounts; i++) {
+        pidcountstruct* curr = &countmap->counts[i];
+
+        // Add threshold condition
+        if (curr->count >= threshold){
+            printf("%d (%d),  ", curr->node_pid, curr->count);
+        }
+    }
+    printf("\n\n");
+}
+
+void top_count(topheap* top, int pid, const char *file_name){
+    //_|> descry: counts one row towards its pid, rows of a pid arrive together so a pid is pushed to the heap once its rows end
+    //_|> top: topheap to count into
+    //_|> pid: pid of the row
+    //_|> file_name: filename of the row, for ranking by type
+    ///_|> returning: returns nothing
+
+    if (pid != top->cur_pid) {
+        top_push(top, top->cur_pid, top->cur_count);
+        top->cur_pid = pid;
+        top->cur_count = 0;
+    }
+    if (top->types == 0 || (strcmp(file_name, "None") != 0 && (fd_type(-1, 0, file_name) & top->types) != 0)) {
+        top->cur_count++;
+    }
+}
+
+void top_push(topheap* top, int pid, int count){
+    //_|> descry: offers a pid's count to the min heap of the k largest, replacing the smallest when full
+    //_|> top: topheap to push to
+    //_|> pid, count: pid and its count
+    ///_|> returning: returns nothing
+
+    if (count == 0) {return;}
+    if (top->n < top->k) {
+
+        // sift the new count up past larger parents
+        int i = top->n++;
+        while (i > 0 && top->heap[(i - 1) / 2].count > count) {
+            top->heap[i] = top->heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        top->heap[i].node_pid = pid;
+        top->heap[i].count = count;
+        return;
+    }
+    if (count <= top->heap[0].count) {return;}
+
+    // replace the smallest, then sift it down past smaller children
+    int i = 0;
+    while (2 * i + 1 < top->n) {
+        int child = 2 * i + 1;
+        if (child + 1 < top->n && top->heap[child + 1].count < top->heap[child].count) {child++;}
+        if (top->heap[child].count >= count) {break;}
+        top->heap[i] = top->heap[child];
+        i = child;
+    }
+    top->heap[i].node_pid = pid;
+    top->heap[i].count = count;
+}
+
+int top_cmp(const void *a, const void *b){
+    //_|> descry: qsort order of the heap for printing, most fds first, then lower pid
+    //_|> a, b: pidcountstructs to compare
+    ///_|> returning: returns <0, 0 or >0
+
+    const pidcountstruct *ca = (const pidcountstruct *)a, *cb = (const pidcountstruct *)b;
+    if (ca->count != cb->count) {return ca->count > cb->count ? -1 : 1;}
+    return (ca->node_pid > cb->node_pid) - (ca->node_pid < cb->node_pid);
+}
+
+void print_top(topheap* top, int live){
+    //_|> descry: pushes the last pid, then prints the k pids with the most fds, most first, with their command name
+    //_|> top: topheap after every row was counted
+    //_|> live: 1 if the rows were just scanned, 0 if loaded, a loaded pid's command name is unknown and shown as ?
+    ///_|> returning: returns nothing
+
+    top_push(top, top->cur_pid, top->cur_count);
+    top->cur_pid = -1;
+    top->cur_count = 0;
+    qsort(top->heap, top->n, sizeof(pidcountstruct), top_cmp);
+
+    printf("         Top %d processes by %s fds\n", top->k, top->label != NULL ? top->label : "open");
+    printf("         PID    Command          FDs\n");
+    printf("        ========================================================\n");
+    for (int i = 0; i < top->n; i++) {
+        char comm[64] = "?";
+        if (live) {read_comm(top->heap[i].node_pid, comm, sizeof(comm));}
+        printf("         %-6d %-16s %d\n", top->heap[i].node_pid, comm, top->heap[i].count);
+    }
+    printf("        ========================================================\n\n");
+}
+
+void group_count(groupby* by, int pid){
+    //_|> descry: counts one row towards the uid, cgroup and executable of its pid, owner metadata is read once when a pid's rows start
+    //_|> by: selected views
+    //_|> pid: pid of the row
+    ///_|> returning: returns nothing
+
+    for (int v = 0; v < by->nviews; v++) {
+        aggview *view = &by->views[v];
+        if (pid != view->cur_pid) {
+            char key[4096];
+            group_key(view->kind, pid, key, sizeof(key));
+            view->cur_id = intern(&view->keys, key);
+            view->cur_pid = pid;
+            group_reserve(view);
+            view->procs[view->cur_id]++;
+        }
+        view->fds[view->cur_id]++;
+    }
+}
+
+void group_key(int kind, int pid, char *key, size_t size){
+    //_|> descry: reads the owner a pid is grouped under, its uid, its cgroup path or its executable path
+    //_|> kind: GROUP_ view kind
+    //_|> pid: pid to read
+    //_|> key: filled with the group name, ? if it cannot be read
+    //_|> size: size of key
+    ///_|> returning: returns nothing
+
+    char proc_path[PATH_BUFFER];
+    snprintf(key, size, "?");
+    if (kind == GROUP_UID) {
+        struct stat sb;
+        snprintf(proc_path, sizeof(proc_path), "%s/%d", proc_root, pid);
+        if (stat(proc_path, &sb) == 0) {snprintf(key, size, "%u", (unsigned int)sb.st_uid);}
+    } else if (kind == GROUP_EXE) {
+        snprintf(proc_path, sizeof(proc_path), "%s/%d/exe", proc_root, pid);
+        ssize_t len = readlink(proc_path, key, size - 1);
+        if (len > 0) {key[len] = '\0';}
+        else {snprintf(key, size, "?");}
+    } else {
+
+        // the unified hierarchy line 0::<path>, or on hybrid setups where it is just / the first v1 path deeper than /
+        char cgroup[4096];
+        snprintf(proc_path, sizeof(proc_path), "%s/%d/cgroup", proc_root, pid);
+        int cgroup_fd = open(proc_path, O_RDONLY | O_CLOEXEC);
+        if (cgroup_fd == -1) {return;}
+        ssize_t len = read(cgroup_fd, cgroup, sizeof(cgroup) - 1);
+        close(cgroup_fd);
+        if (len <= 0) {return;}
+        cgroup[len] = '\0';
+
+        char *unified = NULL, *legacy = NULL, *save;
+        for (char *line = strtok_r(cgroup, "\n", &save); line != NULL; line = strtok_r(NULL, "\n", &save)) {
+            char *path = strchr(line, ':');
+            if (path != NULL) {path = strchr(path + 1, ':');}
+            if (path == NULL) {continue;}
+            path++;
+            if (strncmp(line, "0::", 3) == 0) {unified = path;}
+            else if (legacy == NULL && strcmp(path, "/") != 0) {legacy = path;}
+        }
+        if (unified != NULL && (strcmp(unified, "/") != 0 || legacy == NULL)) {snprintf(key, size, "%s", unified);}
+        else if (legacy != NULL) {snprintf(key, size, "%s", legacy);}
+    }
+}
+
+void group_reserve(aggview* view){
+    //_|> descry: grows a view's count arrays to cover every interned key
+    //_|> view: view to grow
+    ///_|> returning: returns nothing
+
+    if (view->keys.nstrs <= view->cap) {return;}
+    int cap = view->cap == 0 ? COUNT_START : view->cap * 2;
+    long *fds = (long *)realloc(view->fds, cap * sizeof(long));
+    if (fds != NULL) {view->fds = fds;}
+    int *procs = (int *)realloc(view->procs, cap * sizeof(int));
+    if (procs != NULL) {view->procs = procs;}
+    if (fds == NULL || procs == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    memset(view->fds + view->cap, 0, (cap - view->cap) * sizeof(long));
+    memset(view->procs + view->cap, 0, (cap - view->cap) * sizeof(int));
+    view->cap = cap;
+}
+
+void print_groups(groupby* by){
+    //_|> descry: prints each selected view, groups with the most fds first
+    //_|> by: selected views after every row was counted
+    ///_|> returning: returns nothing
+
+    static const char *titles[] = {"user", "cgroup", "executable"};
+    for (int v = 0; v < by->nviews; v++) {
+        aggview *view = &by->views[v];
+        groupcount *order = (groupcount *)malloc((view->keys.nstrs + 1) * sizeof(groupcount));
+        if (order == NULL) {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        for (int id = 0; id < view->keys.nstrs; id++) {
+            order[id].id = id;
+            order[id].procs = view->procs[id];
+            order[id].fds = view->fds[id];
+        }
+        qsort(order, view->keys.nstrs, sizeof(groupcount), group_cmp);
+
+        printf("         FDs by %s\n", titles[view->kind]);
+        printf("         Processes   FDs        %s\n", view->kind == GROUP_UID ? "User" : view->kind == GROUP_CGROUP ? "Cgroup" : "Executable");
+        printf("        ========================================================\n");
+        for (int i = 0; i < view->keys.nstrs; i++) {
+            const char *name = view->keys.strs[order[i].id];
+
+            // uids are resolved to names only here, once per group
+            char user[64];
+            if (view->kind == GROUP_UID && isdigit((unsigned char)name[0])) {
+                struct passwd *pw = getpwuid((uid_t)strtoul(name, NULL, 10));
+                if (pw != NULL) {
+                    snprintf(user, sizeof(user), "%s (%s)", pw->pw_name, name);
+                    name = user;
+                }
+            }
+            printf("         %-11d %-10ld %s\n", order[i].procs, order[i].fds, name);
+        }
+        printf("        ========================================================\n\n");
+        free(order);
+    }
+}
+
+int group_cmp(const void *a, const void *b){
+    //_|> descry: qsort order of a view's groups for printing, most fds first, then first seen
+    //_|> a, b: groupcounts to compare
+    ///_|> returning: returns <0, 0 or >0
+
+    const groupcount *ga = (const groupcount *)a, *gb = (const groupcount *)b;
+    if (ga->fds != gb->fds) {return ga->fds > gb->fds ? -1 : 1;}
+    return (ga->id > gb->id) - (ga->id < gb->id);
+}
+
+void groupby_free(groupby* by){
+    //_|> descry: frees every view's keys and counts
+    //_|> by: views to free
+    ///_|> returning: returns nothing
+
+    for (int v = 0; v < by->nviews; v++) {
+        intern_free(&by->views[v].keys);
+        free(by->views[v].fds);
+        free(by->views[v].procs);
+    }
+    memset(by, 0, sizeof(groupby));
+}
+
+int parse_groups(char *groups, groupby* by){
+    //_|> descry: turns a comma separated --by list into views, in the order given
+    //_|> groups: list of uid, cgroup, exe
+    //_|> by: filled with one view per entry
+    ///_|> returning: returns the number of views, exits on an unknown one
+
+    char *save;
+    memset(by, 0, sizeof(groupby));
+    for (char *group = strtok_r(groups, ",", &save); group != NULL; group = strtok_r(NULL, ",", &save)) {
+        int kind;
+        if (strcmp(group, "uid") == 0 || strcmp(group, "user") == 0) {kind = GROUP_UID;}
+        else if (strcmp(group, "cgroup") == 0) {kind = GROUP_CGROUP;}
+        else if (strcmp(group, "exe") == 0) {kind = GROUP_EXE;}
+        else {
+            fprintf(stderr, "Arguments incorrect\n");
+            exit(1);
+        }
+        if (by->nviews == GROUP_VIEWS) {continue;}
+        by->views[by->nviews].kind = kind;
+        by->views[by->nviews].cur_pid = -1;
+        by->nviews++;
+    }
+    return by->nviews;
+}
+
+void output_text(fdtable* table ){
+    //_|> descry: saves composite table to txt file
+    //_|> table: fdtable of all rows
+    ///_|> returning: returns nothing 
+
+    // generate file or overwrite
+    outwriter out;
+    if (output_open(&out, "compositeTable.txt") != 0) {return;}
+
+    // iterate through rows to print composite table
+    for (size_t i = 0; i < table->count; i++) {
+        pidstruct* curr = &table->rows[i];
+        output_row(&out, curr->node_pid, curr->fd, row_path(table, curr), curr->inode);
+    }
+    output_close(&out);
+}
+
+int output_open(outwriter* out, const char *file_name){
+    //_|> descry: creates or overwrites an output file, starts a writer on it and writes the composite table header
+    //_|> out: writer to start
+    //_|> file_name: file to write
+    ///_|> returning: returns 0, -1 on error
+
+    int file_fd = open(file_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (file_fd == -1) {
+        fprintf(stderr, "Error creating file\n");
+        return -1;
+    }
+    out_init(out, file_fd);
+    out_str(out, "        PID    FD      Filename       Inode\n");
+    out_str(out, "       ========================================================\n");
+    return 0;
+}
+
+void output_row(outwriter* out, int pid, int fd, const char *file_name, long inode){
+    //_|> descry: writes one composite table row to an output file
+    //_|> out: writer of the output file
+    //_|> pid, fd, file_name, inode: row vals
+    ///_|> returning: returns nothing 
+
+    out_str(out, "       "); out_long(out, pid); out_str(out, "        "); out_long(out, fd);
+    out_str(out, "       "); out_str(out, file_name); out_str(out, "     "); out_long(out, inode); out_str(out, "\n");
+}
+
+void output_close(outwriter* out){
+    //_|> descry: writes the composite table footer, flushes and closes the output file
+    //_|> out: writer of the output file
+    ///_|> returning: returns nothing 
+
+    out_str(out,   "       ========================================================\n");
+    out_free(out);
+    close(out->fd);
+}
+
+void output_binary(fdtable* table){
+    //_|> descry: saves the table to compositeTable.bin as a snapshot, columns of pid, fd, inode and path id then a string table of paths
+    //_|> table: fdtable of all rows
+    ///_|> returning: returns nothing 
+
+    // generate file or overwrite
     FILE *fptr;
     fptr = fopen("compositeTable.bin", "wb");
     if (fptr == NULL) {
@@ -508,29 +3393,1165 @@ void output_binary(pidstruct* head){
         return;
     }
 
-    //write to file
-    char line[1200];
-    sprintf(line, "        PID    FD      Filename       Inode\n");
-    fwrite(line, sizeof(char), strlen(line), fptr);
-    sprintf(line, "       ========================================================\n");
-    fwrite(line, sizeof(char), strlen(line), fptr);
-
-    // iterate through pidstruct list to print composite table
-    
-    pidstruct* curr = head;
-    while (curr != NULL) {
-            int pid = curr->node_pid;
-            int fd = curr->fd;
-            char file_name[1000];
-            strcpy(file_name, curr->file_name);
-            int inode = curr->inode;
-            sprintf(line ,"       %d        %d       %s     %d\n",pid, fd, file_name, inode);
-            fwrite(line, sizeof(char), strlen(line), fptr);
-            curr = curr->next;
-        }
-        sprintf(line,   "       ========================================================\n");
-        fwrite(line, sizeof(char), strlen(line), fptr);
-    fclose(fptr);
+    // lay out every section after the header, each starting 8 byte aligned
+    snapheader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAP_MAGIC, sizeof(header.magic));
+    header.version = SNAP_VERSION;
+    header.header_size = sizeof(snapheader);
+    header.taken = (int64_t)time(NULL);
+    gethostname(header.host, sizeof(header.host) - 1);
+    header.nrows = table->count;
+    header.nstrs = (uint64_t)table->paths.nstrs;
+    uint64_t n = header.nrows;
+    header.pid_off = SNAP_ALIGN(sizeof(snapheader));
+    header.fd_off = SNAP_ALIGN(header.pid_off + n * sizeof(int32_t));
+    header.inode_off = SNAP_ALIGN(header.fd_off + n * sizeof(int32_t));
+    header.path_off = SNAP_ALIGN(header.inode_off + n * sizeof(int64_t));
+    header.stroff_off = SNAP_ALIGN(header.path_off + n * sizeof(int32_t));
+    header.hash_off = SNAP_ALIGN(header.stroff_off + header.nstrs * sizeof(uint64_t));
+    header.str_off = SNAP_ALIGN(header.hash_off + header.nstrs * sizeof(uint32_t));
+    for (int id = 0; id < table->paths.nstrs; id++) {
+        header.str_size += strlen(table->paths.strs[id]) + 1;
+    }
+
+    // write each column a block at a time
+    fwrite(&header, sizeof(header), 1, fptr);
+    uint64_t pos = sizeof(header);
+    for (int column = 0; column < 4; column++) {
+        uint64_t offs[] = {header.pid_off, header.fd_off, header.inode_off, header.path_off};
+        pos = snapshot_pad(fptr, pos, offs[column]);
+        for (size_t start = 0; start < table->count; start += SNAP_BLOCK) {
+            int64_t block[SNAP_BLOCK];
+            int32_t *block32 = (int32_t *)block;
+            size_t end = start + SNAP_BLOCK < table->count ? start + SNAP_BLOCK : table->count;
+            for (size_t i = start; i < end; i++) {
+                pidstruct *row = &table->rows[i];
+                if (column == 0) {block32[i - start] = row->node_pid;}
+                else if (column == 1) {block32[i - start] = row->fd;}
+                else if (column == 2) {block[i - start] = row->inode;}
+                else {block32[i - start] = row->path_id;}
+            }
+            size_t width = column == 2 ? sizeof(int64_t) : sizeof(int32_t);
+            fwrite(block, width, end - start, fptr);
+            pos += width * (end - start);
+        }
+    }
+
+    // string table, offset and hash of each path, then the null terminated paths
+    pos = snapshot_pad(fptr, pos, header.stroff_off);
+    uint64_t str_pos = 0;
+    for (int id = 0; id < table->paths.nstrs; id++) {
+        fwrite(&str_pos, sizeof(str_pos), 1, fptr);
+        str_pos += strlen(table->paths.strs[id]) + 1;
+    }
+    pos += header.nstrs * sizeof(uint64_t);
+    pos = snapshot_pad(fptr, pos, header.hash_off);
+    fwrite(table->paths.hashes, sizeof(uint32_t), header.nstrs, fptr);
+    pos += header.nstrs * sizeof(uint32_t);
+    pos = snapshot_pad(fptr, pos, header.str_off);
+    for (int id = 0; id < table->paths.nstrs; id++) {
+        fwrite(table->paths.strs[id], 1, strlen(table->paths.strs[id]) + 1, fptr);
+    }
+    if (ferror(fptr)) {fprintf(stderr, "Error writing file\n");}
+    fclose(fptr);
+}
+
+uint64_t snapshot_pad(FILE *fptr, uint64_t pos, uint64_t off){
+    //_|> descry: writes zero bytes up to the start of the next section
+    //_|> fptr: snapshot file
+    //_|> pos: bytes written so far
+    //_|> off: offset of the next section
+    ///_|> returning: returns off
+
+    static const char zeros[8] = {0};
+    if (off > pos) {fwrite(zeros, 1, off - pos, fptr);}
+    return off;
+}
+
+void snapshot_load(const char *file_name, fdtable* table, void **map, size_t *map_size){
+    //_|> descry: --load, maps a snapshot written by output_binary and fills the table from it, paths are used in place from the mapping
+    //_|> file_name: snapshot to load
+    //_|> table: empty fdtable to fill
+    //_|> map, map_size: set to the mapping, which has to stay mapped while the table is used
+    ///_|> returning: returns nothing, exits if the file is not a valid snapshot
+
+    int snap_fd = open(file_name, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (snap_fd == -1 || fstat(snap_fd, &st) == -1) {
+        fprintf(stderr, "Cannot open snapshot\n");
+        exit(1);
+    }
+    size_t size = (size_t)st.st_size;
+    char *base = size >= sizeof(snapheader) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, snap_fd, 0) : MAP_FAILED;
+    close(snap_fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Not a snapshot file\n");
+        exit(1);
+    }
+
+    // check every section lies inside the file before touching it
+    snapheader *header = (snapheader *)base;
+    uint64_t n = header->nrows, nstrs = header->nstrs;
+    if (memcmp(header->magic, SNAP_MAGIC, sizeof(header->magic)) != 0 || header->version != SNAP_VERSION || header->header_size != sizeof(snapheader)
+        || n > size || nstrs > size || nstrs > INT32_MAX
+        || !snapshot_fits(size, header->pid_off, n * sizeof(int32_t)) || !snapshot_fits(size, header->fd_off, n * sizeof(int32_t))
+        || !snapshot_fits(size, header->inode_off, n * sizeof(int64_t)) || !snapshot_fits(size, header->path_off, n * sizeof(int32_t))
+        || !snapshot_fits(size, header->stroff_off, nstrs * sizeof(uint64_t)) || !snapshot_fits(size, header->hash_off, nstrs * sizeof(uint32_t))
+        || !snapshot_fits(size, header->str_off, header->str_size) || (header->str_size > 0 && base[header->str_off + header->str_size - 1] != '\0')) {
+        fprintf(stderr, "Not a snapshot file\n");
+        exit(1);
+    }
+    const int32_t *pids = (const int32_t *)(base + header->pid_off);
+    const int32_t *fds = (const int32_t *)(base + header->fd_off);
+    const int64_t *inodes = (const int64_t *)(base + header->inode_off);
+    const int32_t *path_ids = (const int32_t *)(base + header->path_off);
+    const uint64_t *str_offs = (const uint64_t *)(base + header->stroff_off);
+    const uint32_t *hashes = (const uint32_t *)(base + header->hash_off);
+
+    // intern table points at the mapped paths, slots are rebuilt from the stored hashes
+    internstruct *paths = &table->paths;
+    paths->nslots = INTERN_START;
+    while ((uint64_t)paths->nslots < nstrs * 2) {paths->nslots *= 2;}
+    paths->slots = (int *)calloc(paths->nslots, sizeof(int));
+    paths->strs = (char **)malloc((paths->nslots / 2) * sizeof(char *));
+    paths->hashes = (unsigned int *)malloc((paths->nslots / 2) * sizeof(unsigned int));
+    if (paths->slots == NULL || paths->strs == NULL || paths->hashes == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    unsigned int mask = (unsigned int)paths->nslots - 1;
+    for (uint64_t id = 0; id < nstrs; id++) {
+        if (str_offs[id] >= header->str_size) {
+            fprintf(stderr, "Not a snapshot file\n");
+            exit(1);
+        }
+        paths->strs[id] = base + header->str_off + str_offs[id];
+        paths->hashes[id] = hashes[id];
+        unsigned int slot = hashes[id] & mask;
+        while (paths->slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        paths->slots[slot] = (int)id + 1;
+    }
+    paths->nstrs = (int)nstrs;
+
+    // rows from the columns
+    table_reserve(table, n);
+    for (uint64_t i = 0; i < n; i++) {
+        if (path_ids[i] < 0 || (uint64_t)path_ids[i] >= nstrs) {
+            fprintf(stderr, "Not a snapshot file\n");
+            exit(1);
+        }
+        pidstruct *row = &table->rows[i];
+        row->node_pid = pids[i];
+        row->fd = fds[i];
+        row->inode = inodes[i];
+        row->path_id = path_ids[i];
+    }
+    table->count = n;
+
+    char taken[64];
+    time_t when = (time_t)header->taken;
+    strftime(taken, sizeof(taken), "%Y-%m-%d %H:%M:%S", localtime(&when));
+
+    // to stderr, stdout only carries the tables so --format=csv|json|ndjson stays parseable
+    fprintf(stderr, "Snapshot of %.*s taken %s\n", (int)sizeof(header->host), header->host, taken);
+    *map = base;
+    *map_size = size;
+}
+
+int snapshot_fits(size_t size, uint64_t off, uint64_t len){
+    //_|> descry: checks a snapshot section is aligned and inside the file
+    //_|> size: file size
+    //_|> off, len: section offset and length
+    ///_|> returning: returns 1 if it fits, 0 if not
+
+    return off % 8 == 0 && off <= size && len <= size - off;
+}
+
+void archive_append(const char *file_name, fdtable* table){
+    //_|> descry: --archive, appends the table to an archive as the rows removed and added since its last snapshot, the first one holds every row
+    //_|> file_name: archive to append to, created if missing
+    //_|> table: fdtable of this scan
+    ///_|> returning: returns nothing
+
+    int arch_fd = open(file_name, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat st;
+    if (arch_fd == -1 || flock(arch_fd, LOCK_EX) == -1 || fstat(arch_fd, &st) == -1) {
+        fprintf(stderr, "Error creating file\n");
+        if (arch_fd != -1) {close(arch_fd);}
+        return;
+    }
+
+    // rebuild the last snapshot from the last keyframe, its paths are the dictionary new paths are added to
+    fdtable prev;
+    memset(&prev, 0, sizeof(prev));
+    size_t size = (size_t)st.st_size;
+    size_t end = size;
+    int records = 0, index = 0;
+    archheader header;
+    outwriter out;
+    out_init(&out, arch_fd);
+    if (size == 0) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, ARCH_MAGIC, sizeof(header.magic));
+        header.version = ARCH_VERSION;
+        header.header_size = sizeof(archheader);
+        gethostname(header.host, sizeof(header.host) - 1);
+        out_bytes(&out, (const char *)&header, sizeof(header));
+        end = sizeof(header);
+    } else {
+        char *base = size >= sizeof(archheader) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, arch_fd, 0) : MAP_FAILED;
+        if (base == MAP_FAILED || memcmp(((archheader *)base)->magic, ARCH_MAGIC, sizeof(header.magic)) != 0) {
+            fprintf(stderr, "Not an archive file\n");
+            exit(1);
+        }
+        memcpy(&header, base, sizeof(header));
+        int64_t taken;
+        end = archive_replay(base, size, archive_start(base, size, INT64_MAX, &index), INT64_MAX, &prev, &records, &taken);
+        munmap(base, size);
+
+        // a record cut short by a crash is dropped, so this one lands right after the last whole record
+        if (end < size) {
+            fprintf(stderr, "Dropping %zu bytes of an incomplete archive record\n", size - end);
+            if (ftruncate(arch_fd, (off_t)end) == -1) {
+                fprintf(stderr, "Error writing file\n");
+                out_free(&out);
+                close(arch_fd);
+                table_free(&prev);
+                return;
+            }
+        }
+    }
+
+    // every ARCH_KEYFRAME records the table is stored whole again, against no rows and a fresh dictionary
+    int keyframe = records == 0 || records >= ARCH_KEYFRAME;
+    if (keyframe) {table_free(&prev);}
+    if (size != 0 && lseek(arch_fd, (off_t)end, SEEK_SET) == -1) {out.failed = 1;}
+
+    // this scan's rows in key order, path ids moved into the archive dictionary
+    int old_nstrs = prev.paths.nstrs;
+    pidstruct *rows = (pidstruct *)malloc((table->count + 1) * sizeof(pidstruct));
+    if (rows == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    for (size_t i = 0; i < table->count; i++) {
+        rows[i] = table->rows[i];
+        rows[i].path_id = intern(&prev.paths, row_path(table, &table->rows[i]));
+    }
+    qsort(rows, table->count, sizeof(pidstruct), row_cmp);
+
+    // new paths, then walk both snapshots in key order, a reopened fd is removed and added again
+    archrecord rec;
+    memset(&rec, 0, sizeof(rec));
+    memcpy(rec.tag, keyframe ? ARCH_KEYTAG : ARCH_TAG, sizeof(rec.tag));
+    rec.taken = (int64_t)time(NULL);
+    rec.nrows = table->count;
+    rec.nstrs = (uint32_t)(prev.paths.nstrs - old_nstrs);
+    archbuf strs = {NULL, 0, 0}, removed = {NULL, 0, 0}, added = {NULL, 0, 0};
+    for (int id = old_nstrs; id < prev.paths.nstrs; id++) {
+        size_t len = strlen(prev.paths.strs[id]);
+        put_varint(&strs, len);
+        archbuf_put(&strs, prev.paths.strs[id], len);
+    }
+    pidstruct last_removed = {0, 0, 0, 0}, last_added = {0, 0, 0, 0};
+    size_t i = 0, j = 0;
+    while (i < prev.count || j < table->count) {
+        pidstruct *old = i < prev.count ? &prev.rows[i] : NULL;
+        pidstruct *now = j < table->count ? &rows[j] : NULL;
+        int order = old == NULL ? 1 : now == NULL ? -1 : row_cmp(old, now);
+        int changed = order == 0 && (old->inode != now->inode || old->path_id != now->path_id);
+        if (order < 0 || changed) {
+            archive_put_key(&removed, &last_removed, old, 0);
+            rec.nremoved++;
+        }
+        if (order > 0 || changed) {
+            archive_put_key(&added, &last_added, now, 1);
+            rec.nadded++;
+        }
+        if (order <= 0) {i++;}
+        if (order >= 0) {j++;}
+    }
+    rec.size = strs.used + removed.used + added.used;
+
+    // one record, header first so a reader can skip it whole
+    out_bytes(&out, (const char *)&rec, sizeof(rec));
+    out_bytes(&out, (const char *)strs.buf, strs.used);
+    out_bytes(&out, (const char *)removed.buf, removed.used);
+    out_bytes(&out, (const char *)added.buf, added.used);
+    out_free(&out);
+    if (out.failed == 1 || fsync(arch_fd) == -1) {
+        fprintf(stderr, "Error writing file\n");
+    } else if (keyframe) {
+
+        // the header only points at a keyframe once it is whole on disk
+        header.keyframe = end;
+        header.keyframe_index = (uint64_t)(index + records);
+        if (pwrite(arch_fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) || fsync(arch_fd) == -1) {
+            fprintf(stderr, "Error writing file\n");
+        }
+    }
+    close(arch_fd);
+
+    free(strs.buf);
+    free(removed.buf);
+    free(added.buf);
+    free(rows);
+    table_free(&prev);
+}
+
+int archive_load(const char *file_name, const char *at, fdtable* table){
+    //_|> descry: --load of an archive, replays its records up to the last one taken at or before --at
+    //_|> file_name: file to load
+    //_|> at: time to load the snapshot of, NULL for the latest
+    //_|> table: empty fdtable to fill, in pid and fd order
+    ///_|> returning: returns 1 if the file was an archive and is loaded, 0 if it is not an archive
+
+    int arch_fd = open(file_name, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (arch_fd == -1 || fstat(arch_fd, &st) == -1) {
+        fprintf(stderr, "Cannot open snapshot\n");
+        exit(1);
+    }
+    size_t size = (size_t)st.st_size;
+    char *base = size >= sizeof(archheader) ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, arch_fd, 0) : MAP_FAILED;
+    close(arch_fd);
+    if (base == MAP_FAILED) {return 0;}
+    archheader *header = (archheader *)base;
+    if (memcmp(header->magic, ARCH_MAGIC, sizeof(header->magic)) != 0) {
+        munmap(base, size);
+        return 0;
+    }
+    if (header->version != ARCH_VERSION || header->header_size != sizeof(archheader)) {
+        fprintf(stderr, "Not an archive file\n");
+        exit(1);
+    }
+
+    int64_t until = at == NULL ? INT64_MAX : parse_time(at);
+    int records = 0, index = 0;
+    int64_t taken = 0;
+    archive_replay(base, size, archive_start(base, size, until, &index), until, table, &records, &taken);
+    if (records == 0) {
+        fprintf(stderr, "No archived snapshot at or before %s\n", at == NULL ? "now" : at);
+        exit(1);
+    }
+
+    char when_str[64];
+    time_t when = (time_t)taken;
+    strftime(when_str, sizeof(when_str), "%Y-%m-%d %H:%M:%S", localtime(&when));
+
+    // to stderr like the snapshot banner, stdout only carries the tables
+    fprintf(stderr, "Archive of %.*s, snapshot %d taken %s\n", (int)sizeof(header->host), header->host, index + records, when_str);
+    munmap(base, size);
+    return 1;
+}
+
+size_t archive_start(const char *base, size_t size, int64_t at, int *index){
+    //_|> descry: finds the keyframe to replay from, the one in the header for the latest snapshot, else the last one taken at or before at
+    //_|> base, size: mapped archive, magic already checked
+    //_|> at: last time to replay up to, INT64_MAX for every record
+    //_|> index: set to the number of records before the keyframe
+    ///_|> returning: returns the offset of the keyframe, or of the first record if there is none yet
+
+    archheader *header = (archheader *)base;
+    archrecord rec;
+    if (header->version != ARCH_VERSION || header->header_size != sizeof(archheader) || header->keyframe > size - sizeof(archrecord)
+        || (header->keyframe != 0 && (header->keyframe < sizeof(archheader) || memcmp(base + header->keyframe, ARCH_KEYTAG, sizeof(rec.tag)) != 0))) {
+        fprintf(stderr, "Not an archive file\n");
+        exit(1);
+    }
+    *index = 0;
+    if (header->keyframe == 0) {return sizeof(archheader);}
+    if (at == INT64_MAX) {
+        *index = (int)header->keyframe_index;
+        return header->keyframe;
+    }
+
+    // only the record headers are read on the way
+    size_t start = sizeof(archheader);
+    int count = 0;
+    for (size_t off = start; size - off >= sizeof(archrecord); off += sizeof(rec) + rec.size, count++) {
+        memcpy(&rec, base + off, sizeof(rec));
+        if (rec.size > size - off - sizeof(rec) || rec.taken > at) {break;}
+        if (memcmp(rec.tag, ARCH_KEYTAG, sizeof(rec.tag)) == 0) {
+            start = off;
+            *index = count;
+        } else if (memcmp(rec.tag, ARCH_TAG, sizeof(rec.tag)) != 0) {
+            break;
+        }
+    }
+    return start;
+}
+
+size_t archive_replay(const char *base, size_t size, size_t from, int64_t at, fdtable* state, int *records, int64_t *taken){
+    //_|> descry: applies the records of a mapped archive in order, stopping at the first one taken after at or at an incomplete record
+    //_|> base, size: mapped archive, header already checked
+    //_|> from: offset of the keyframe to start at, from archive_start
+    //_|> at: last time to replay up to, INT64_MAX for every record
+    //_|> state: empty fdtable, left holding the replayed snapshot with the path dictionary as its paths
+    //_|> records: set to the number of records applied
+    //_|> taken: set to the time of the last record applied
+    ///_|> returning: returns the offset just past the last whole record
+
+    size_t off = from;
+    *records = 0;
+    while (size - off >= sizeof(archrecord)) {
+
+        // records are unaligned, copy the header out
+        archrecord rec;
+        memcpy(&rec, base + off, sizeof(rec));
+        int key = memcmp(rec.tag, ARCH_KEYTAG, sizeof(rec.tag)) == 0;
+        if ((!key && memcmp(rec.tag, ARCH_TAG, sizeof(rec.tag)) != 0) || rec.size > size - off - sizeof(rec)) {break;}
+        if (rec.taken > at) {return off;}
+
+        // a keyframe starts over from no rows and an empty dictionary
+        if (key) {table_free(state);}
+        archive_apply(state, (const unsigned char *)base + off + sizeof(rec), &rec);
+        off += sizeof(rec) + rec.size;
+        *taken = rec.taken;
+        (*records)++;
+    }
+    return off;
+}
+
+void archive_apply(fdtable* state, const unsigned char *pos, archrecord* rec){
+    //_|> descry: applies one record to the snapshot before it, adding its paths to the dictionary then merging the removed and added rows
+    //_|> state: fdtable in pid and fd order
+    //_|> pos: start of the record's varints
+    //_|> rec: record header
+    ///_|> returning: returns nothing, exits if the record is corrupt
+
+    const unsigned char *end = pos + rec->size;
+    int ok = rec->nremoved <= state->count && rec->nadded <= rec->size && rec->nstrs <= rec->size;
+
+    // dictionary ids are given in the order paths were added, so interning them again reproduces the ids
+    char path[PATH_BUFFER];
+    for (uint32_t n = 0; ok && n < rec->nstrs; n++) {
+        uint64_t len;
+        ok = get_varint(&pos, end, &len) && len < sizeof(path) && len <= (uint64_t)(end - pos);
+        if (!ok) {break;}
+        memcpy(path, pos, len);
+        path[len] = '\0';
+        pos += len;
+        ok = memchr(path, '\0', len) == NULL && intern(&state->paths, path) == state->paths.nstrs - 1;
+    }
+
+    // keys to drop and rows to add, each list in key order
+    pidstruct *removed = (pidstruct *)malloc((rec->nremoved + 1) * sizeof(pidstruct));
+    pidstruct *added = (pidstruct *)malloc((rec->nadded + 1) * sizeof(pidstruct));
+    if (removed == NULL || added == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    pidstruct last = {0, 0, 0, 0};
+    for (uint64_t n = 0; ok && n < rec->nremoved; n++) {
+        ok = archive_key(&pos, end, &last, &removed[n], 0);
+    }
+    memset(&last, 0, sizeof(last));
+    for (uint64_t n = 0; ok && n < rec->nadded; n++) {
+        ok = archive_key(&pos, end, &last, &added[n], 1) && last.path_id >= 0 && last.path_id < state->paths.nstrs;
+    }
+    if (!ok || pos != end || state->count - rec->nremoved + rec->nadded != rec->nrows) {
+        fprintf(stderr, "Not an archive file\n");
+        exit(1);
+    }
+
+    // one merge pass, every removed key has to be found
+    pidstruct *rows = (pidstruct *)malloc((rec->nrows + 1) * sizeof(pidstruct));
+    if (rows == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    size_t count = 0, i = 0, r = 0, a = 0;
+    while (i < state->count || a < rec->nadded) {
+        if (i < state->count && r < rec->nremoved && row_cmp(&state->rows[i], &removed[r]) == 0) {
+            i++;
+            r++;
+            continue;
+        }
+        int order = i == state->count ? 1 : a == rec->nadded ? -1 : row_cmp(&state->rows[i], &added[a]);
+        if (order == 0 || count == rec->nrows) {break;}
+        rows[count++] = order < 0 ? state->rows[i++] : added[a++];
+    }
+    if (r != rec->nremoved || count != rec->nrows) {
+        fprintf(stderr, "Not an archive file\n");
+        exit(1);
+    }
+    free(state->rows);
+    state->rows = rows;
+    state->count = count;
+    state->cap = rec->nrows + 1;
+    free(removed);
+    free(added);
+}
+
+int archive_key(const unsigned char **pos, const unsigned char *end, pidstruct* last, pidstruct* row, int full){
+    //_|> descry: decodes one removed key or added row, relative to the one before it in the same list
+    //_|> pos, end: varints left in the record
+    //_|> last: previous key or row of the list, updated to this one
+    //_|> row: filled with the key or row
+    //_|> full: 1 for an added row with inode and path id, 0 for a removed pid/fd key
+    ///_|> returning: returns 1 on success, 0 if the record is corrupt
+
+    uint64_t pid_delta, fd, inode, path_id;
+    if (!get_varint(pos, end, &pid_delta) || !get_varint(pos, end, &fd)) {return 0;}
+    if (pid_delta > INT32_MAX || last->node_pid + pid_delta > INT32_MAX) {return 0;}
+    row->node_pid = last->node_pid + (int)pid_delta;
+    if (pid_delta == 0) {fd += (uint64_t)last->fd;}
+    if (fd > INT32_MAX) {return 0;}
+    row->fd = (int)fd;
+    row->inode = 0;
+    row->path_id = 0;
+    if (full == 1) {
+        if (!get_varint(pos, end, &inode) || !get_varint(pos, end, &path_id)) {return 0;}
+        row->inode = (long)((uint64_t)last->inode + ((inode >> 1) ^ -(inode & 1)));
+        row->path_id = (int)((uint64_t)last->path_id + ((path_id >> 1) ^ -(path_id & 1)));
+    }
+    *last = *row;
+    return 1;
+}
+
+void archive_put_key(archbuf* buf, pidstruct* last, pidstruct* row, int full){
+    //_|> descry: encodes one removed key or added row, relative to the one before it in the same list
+    //_|> buf: record list to append to
+    //_|> last: previous key or row of the list, updated to this one
+    //_|> row: key or row, rows come in key order
+    //_|> full: 1 to include inode and path id, 0 for just pid and fd
+    ///_|> returning: returns nothing
+
+    put_varint(buf, (uint64_t)(row->node_pid - last->node_pid));
+    put_varint(buf, (uint64_t)(row->node_pid == last->node_pid ? row->fd - last->fd : row->fd));
+    if (full == 1) {
+        int64_t inode = (int64_t)row->inode - (int64_t)last->inode;
+        int64_t path_id = (int64_t)row->path_id - (int64_t)last->path_id;
+        put_varint(buf, ((uint64_t)inode << 1) ^ (uint64_t)(inode >> 63));
+        put_varint(buf, ((uint64_t)path_id << 1) ^ (uint64_t)(path_id >> 63));
+    }
+    *last = *row;
+}
+
+int get_varint(const unsigned char **pos, const unsigned char *end, uint64_t *val){
+    //_|> descry: reads a little endian base 128 varint
+    //_|> pos: read position, moved past the varint
+    //_|> end: end of the readable bytes
+    //_|> val: set to the value
+    ///_|> returning: returns 1 on success, 0 if the varint runs past end or is too long
+
+    *val = 0;
+    for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+        unsigned char byte = *(*pos)++;
+        *val |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {return 1;}
+    }
+    return 0;
+}
+
+void put_varint(archbuf* buf, uint64_t val){
+    //_|> descry: appends a little endian base 128 varint, 7 bits a byte with the top bit set on all but the last
+    //_|> buf: buffer to append to
+    //_|> val: value to encode
+    ///_|> returning: returns nothing
+
+    unsigned char bytes[10];
+    size_t len = 0;
+    while (val >= 0x80) {
+        bytes[len++] = (unsigned char)(val | 0x80);
+        val >>= 7;
+    }
+    bytes[len++] = (unsigned char)val;
+    archbuf_put(buf, bytes, len);
+}
+
+void archbuf_put(archbuf* buf, const void *data, size_t len){
+    //_|> descry: appends bytes, capacity doubles so appends stay O(1)
+    //_|> buf: buffer to append to
+    //_|> data, len: bytes to append
+    ///_|> returning: returns nothing
+
+    if (buf->used + len > buf->cap) {
+        size_t cap = buf->cap == 0 ? ARENA_CHUNK : buf->cap;
+        while (cap < buf->used + len) {
+            cap *= 2;
+        }
+        unsigned char *grown = (unsigned char *)realloc(buf->buf, cap);
+        if (grown == NULL) {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        buf->buf = grown;
+        buf->cap = cap;
+    }
+    memcpy(buf->buf + buf->used, data, len);
+    buf->used += len;
+}
+
+int64_t parse_time(const char *str){
+    //_|> descry: reads an --at time, seconds since the epoch or local "YYYY-MM-DD HH:MM[:SS]"
+    //_|> str: time argument
+    ///_|> returning: returns seconds since the epoch, exits if str is neither
+
+    char *end;
+    long long secs = strtoll(str, &end, 10);
+    if (end != str && *end == '\0') {return (int64_t)secs;}
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    end = strptime(str, "%Y-%m-%d %H:%M", &tm);
+    if (end != NULL && *end == ':') {end = strptime(end + 1, "%S", &tm);}
+    if (end == NULL || *end != '\0') {
+        fprintf(stderr, "Arguments incorrect\n");
+        exit(1);
+    }
+    tm.tm_isdst = -1;
+    return (int64_t)mktime(&tm);
 }
 
-    
\ No newline at end of file
+void holders_build(fdtable* table, holderindex* index){
+    //_|> descry: builds the type and inode and the filename index over every row, chains are kept in scan order
+    //_|> table: fdtable of all rows
+    //_|> index: holderindex to fill
+    ///_|> returning: returns nothing
+
+    int nrows = (int)table->count;
+    index->ninode_slots = COUNT_START;
+    while (index->ninode_slots < nrows * 2) {
+        index->ninode_slots *= 2;
+    }
+    index->first_by_path = (int *)malloc((table->paths.nstrs + 1) * sizeof(int));
+    index->next_by_path = (int *)malloc((nrows + 1) * sizeof(int));
+    index->inode_slots = (int *)calloc(index->ninode_slots, sizeof(int));
+    index->next_by_inode = (int *)malloc((nrows + 1) * sizeof(int));
+    if (index->first_by_path == NULL || index->next_by_path == NULL || index->inode_slots == NULL || index->next_by_inode == NULL) {
+        fprintf(stderr, "Insufficient memory");
+        exit(1);
+    }
+    for (int id = 0; id < table->paths.nstrs; id++) {
+        index->first_by_path[id] = -1;
+    }
+
+    // walk rows backwards and push each on the front of its chains
+    unsigned int mask = (unsigned int)index->ninode_slots - 1;
+    for (int i = nrows - 1; i >= 0; i--) {
+        pidstruct *row = &table->rows[i];
+        index->next_by_path[i] = index->first_by_path[row->path_id];
+        index->first_by_path[row->path_id] = i;
+
+        // rows without a real inode are left out of the inode index, socket, pipe and file inode numbers are separate spaces
+        index->next_by_inode[i] = -1;
+        if (row->inode <= 0) {continue;}
+        int type = fd_type(-1, 0, row_path(table, row));
+        unsigned int slot = ((unsigned long)row->inode * 2654435761u + (unsigned int)type) & mask;
+        while (index->inode_slots[slot] != 0) {
+            pidstruct *curr = &table->rows[index->inode_slots[slot] - 1];
+            if (curr->inode == row->inode && fd_type(-1, 0, row_path(table, curr)) == type) {break;}
+            slot = (slot + 1) & mask;
+        }
+        index->next_by_inode[i] = index->inode_slots[slot] - 1;
+        index->inode_slots[slot] = i + 1;
+    }
+}
+
+int holders_by_inode(fdtable* table, holderindex* index, int type, long inode){
+    //_|> descry: finds the first row holding inode of the given type, the rest follow through next_by_inode
+    //_|> table: fdtable of all rows
+    //_|> index: built holderindex
+    //_|> type: TYPE_ bit of the object, a socket and a file can have the same inode number
+    //_|> inode: inode to look up
+    ///_|> returning: returns the first row index, -1 if nothing holds it
+
+    if (inode <= 0) {return -1;}
+    unsigned int mask = (unsigned int)index->ninode_slots - 1;
+    unsigned int slot = ((unsigned long)inode * 2654435761u + (unsigned int)type) & mask;
+    while (index->inode_slots[slot] != 0) {
+        int first = index->inode_slots[slot] - 1;
+        if (table->rows[first].inode == inode && fd_type(-1, 0, row_path(table, &table->rows[first])) == type) {return first;}
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+void holders_free(holderindex* index){
+    //_|> descry: frees the holderindex chains and slots
+    //_|> index: holderindex to free
+    ///_|> returning: returns nothing
+
+    free(index->first_by_path);
+    free(index->next_by_path);
+    free(index->inode_slots);
+    free(index->next_by_inode);
+    memset(index, 0, sizeof(holderindex));
+}
+
+void print_holders(fdtable* table, holderindex* index, const char *query, netinfo* net, int live){
+    //_|> descry: prints every pid, fd holding the file, socket or pipe in query, and the holders of a unix socket's peer
+    //_|> table: fdtable of all rows
+    //_|> index: built holderindex
+    //_|> query: filename, type:[inode] name or inode number
+    //_|> net: socket tables, NULL when --sockets is off
+    //_|> live: 1 if the table was just scanned, 0 if it was loaded and pipe ends and peers in /proc and sock_diag are of other processes
+    ///_|> returning: returns nothing
+
+    // all digits is a file's inode, anything else a filename, socket:[N] and pipe:[N] names are looked up by their inode
+    int first = -1;
+    int by_inode = 1;
+    long inode = -1;
+    int type = TYPE_FILE;
+    const char *digit = query;
+    while (isdigit((unsigned char)*digit)) {digit++;}
+    if (*query != '\0' && *digit == '\0') {
+        inode = strtol(query, NULL, 10);
+    } else {
+        inode = parse_link_inode(query);
+        type = fd_type(-1, 0, query);
+    }
+    if (inode > 0) {
+        first = holders_by_inode(table, index, type, inode);
+    } else {
+        int path_id = intern_find(&table->paths, query);
+        by_inode = 0;
+        if (path_id != -1) {first = index->first_by_path[path_id];}
+    }
+
+    printf("         Holders of %s\n", query);
+    print_header(4);
+    long socket_inode = -1;
+    char desc[160];
+    for (int i = first; i != -1; i = by_inode ? index->next_by_inode[i] : index->next_by_path[i]) {
+        pidstruct *row = &table->rows[i];
+        const char *file_name = row_path(table, row);
+        printf("       %d        %d       %s     %ld%s%s\n", row->node_pid, row->fd, file_name, row->inode, live ? pipe_end(file_name, row->node_pid, row->fd) : "", sock_desc(net, file_name, row->inode, desc, sizeof(desc)));
+        if (strncmp(file_name, "socket:[", 8) == 0) {socket_inode = row->inode;}
+    }
+    printf("       ========================================================\n");
+
+    // the other end of a unix socket is a different inode, find it and list its holders too
+    long peer = live ? unix_peer(socket_inode) : -1;
+    if (peer > 0) {
+        printf("         Peer socket:[%ld]\n", peer);
+        print_header(4);
+        for (int i = holders_by_inode(table, index, TYPE_SOCKET, peer); i != -1; i = index->next_by_inode[i]) {
+            pidstruct *row = &table->rows[i];
+            printf("       %d        %d       %s     %ld\n", row->node_pid, row->fd, row_path(table, row), row->inode);
+        }
+        printf("       ========================================================\n");
+    }
+    printf("\n");
+}
+
+const char *pipe_end(const char *file_name, int pid, int fd){
+    //_|> descry: tells which end of a pipe an fd holds, from the access mode in /proc/<pid>/fdinfo/<fd>
+    //_|> file_name: filename of the fd
+    //_|> pid, fd: fd to check
+    ///_|> returning: returns a label to append to the row, empty if not a pipe or unknown
+
+    if (strncmp(file_name, "pipe:[", 6) != 0) {return "";}
+
+    char info_path[PATH_BUFFER];
+    char info[256];
+    snprintf(info_path, sizeof(info_path), "%s/%d/fdinfo/%d", proc_root, pid, fd);
+    int info_fd = open(info_path, O_RDONLY | O_CLOEXEC);
+    if (info_fd == -1) {return "";}
+    ssize_t len = read(info_fd, info, sizeof(info) - 1);
+    close(info_fd);
+    if (len <= 0) {return "";}
+    info[len] = '\0';
+
+    // flags are octal, the low two bits are the access mode
+    char *flags = strstr(info, "flags:");
+    if (flags == NULL) {return "";}
+    long mode = strtol(flags + 6, NULL, 8) & O_ACCMODE;
+    if (mode == O_RDONLY) {return "     read end";}
+    if (mode == O_WRONLY) {return "     write end";}
+    return "     read/write end";
+}
+
+long unix_peer(long inode){
+    //_|> descry: asks the kernel through sock_diag for the peer of a unix socket
+    //_|> inode: socket inode
+    ///_|> returning: returns the peer socket inode, -1 if not a connected unix socket
+
+    if (inode <= 0) {return -1;}
+    int nl = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (nl == -1) {return -1;}
+
+    // exact lookup of one inode, no cookie check
+    struct {
+        struct nlmsghdr nlh;
+        struct unix_diag_req req;
+    } msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.nlh.nlmsg_len = sizeof(msg);
+    msg.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    msg.nlh.nlmsg_flags = NLM_F_REQUEST;
+    msg.req.sdiag_family = AF_UNIX;
+    msg.req.udiag_states = -1;
+    msg.req.udiag_ino = (unsigned int)inode;
+    msg.req.udiag_show = UDIAG_SHOW_PEER;
+    msg.req.udiag_cookie[0] = INET_DIAG_NOCOOKIE;
+    msg.req.udiag_cookie[1] = INET_DIAG_NOCOOKIE;
+
+    long peer = -1;
+    long reply[1024];
+    ssize_t len = -1;
+    if (send(nl, &msg, sizeof(msg), 0) == (ssize_t)sizeof(msg)) {
+        len = recv(nl, reply, sizeof(reply), 0);
+    }
+    close(nl);
+
+    // walk the attributes after the unix_diag_msg for UNIX_DIAG_PEER
+    struct nlmsghdr *nlh = (struct nlmsghdr *)reply;
+    if (len > 0 && NLMSG_OK(nlh, (size_t)len) && nlh->nlmsg_type == SOCK_DIAG_BY_FAMILY) {
+        struct unix_diag_msg *diag = (struct unix_diag_msg *)NLMSG_DATA(nlh);
+        struct rtattr *attr = (struct rtattr *)(diag + 1);
+        int attr_len = (int)nlh->nlmsg_len - NLMSG_LENGTH(sizeof(*diag));
+        for (; RTA_OK(attr, attr_len); attr = RTA_NEXT(attr, attr_len)) {
+            if (attr->rta_type == UNIX_DIAG_PEER) {
+                peer = *(unsigned int *)RTA_DATA(attr);
+            }
+        }
+    }
+    return peer;
+}
+
+void net_load(netinfo* net){
+    //_|> descry: reads /proc/net tcp, tcp6, udp, udp6 and unix once into the inode keyed socket table
+    //_|> net: netinfo to fill
+    ///_|> returning: returns nothing
+
+    static const char *files[] = {"net/tcp", "net/tcp6", "net/udp", "net/udp6", "net/unix"};
+    memset(net, 0, sizeof(netinfo));
+    for (int proto = PROTO_TCP; proto <= PROTO_UNIX; proto++) {
+
+        // unix paths point into the buffer, so it gets its own buffer that is kept
+        char **buf = proto == PROTO_UNIX ? &net->unix_buf : &net->buf;
+        size_t *size = proto == PROTO_UNIX ? &net->unix_size : &net->size;
+        char file_path[PATH_BUFFER];
+        snprintf(file_path, sizeof(file_path), "%s/%s", proc_root, files[proto]);
+        size_t len = read_whole(file_path, buf, size);
+        if (len == 0) {continue;}
+
+        // skip the header line, then parse each line in place
+        char *line = memchr(*buf, '\n', len);
+        char *end = *buf + len;
+        while (line != NULL && ++line < end) {
+            char *next = memchr(line, '\n', end - line);
+            if (next == NULL) {next = end;}
+            *next = '\0';
+            if (proto == PROTO_UNIX) {
+                net_parse_unix(net, line);
+            } else {
+                net_parse_inet(net, line, proto);
+            }
+            line = next;
+        }
+    }
+}
+
+size_t read_whole(const char *file_path, char **buf, size_t *size){
+    //_|> descry: reads a whole file into a reusable buffer with large reads, the buffer doubles when it fills up
+    //_|> file_path: file to read
+    //_|> buf: buffer, grown as needed
+    //_|> size: buffer size
+    ///_|> returning: returns the number of bytes read, 0 on error
+
+    int file_fd = open(file_path, O_RDONLY | O_CLOEXEC);
+    if (file_fd == -1) {return 0;}
+    size_t len = 0;
+    while (1) {
+        if (*size - len < NET_READ) {
+            size_t grown_size = *size == 0 ? NET_BUFFER : *size * 2;
+            char *grown = (char *)realloc(*buf, grown_size + 1);
+            if (grown == NULL) {
+                fprintf(stderr, "Insufficient memory");
+                exit(1);
+            }
+            *buf = grown;
+            *size = grown_size;
+        }
+        ssize_t got = read(file_fd, *buf + len, *size - len);
+        if (got <= 0) {break;}
+        len += got;
+    }
+    close(file_fd);
+    (*buf)[len] = '\0';
+    return len;
+}
+
+char *skip_fields(char *pos, int count){
+    //_|> descry: moves past count whitespace separated fields
+    //_|> pos: position in a line
+    //_|> count: fields to skip
+    ///_|> returning: returns the start of the next field
+
+    for (int i = 0; i < count; i++) {
+        while (*pos == ' ') {pos++;}
+        while (*pos != ' ' && *pos != '\0') {pos++;}
+    }
+    while (*pos == ' ') {pos++;}
+    return pos;
+}
+
+unsigned long scan_hex(char **pos){
+    //_|> descry: reads a hex number and moves past it
+    //_|> pos: position in a line, moved past the digits
+    ///_|> returning: returns the value
+
+    unsigned long val = 0;
+    for (;; (*pos)++) {
+        char c = **pos;
+        if (c >= '0' && c <= '9') {val = (val << 4) | (unsigned long)(c - '0');}
+        else if (c >= 'A' && c <= 'F') {val = (val << 4) | (unsigned long)(c - 'A' + 10);}
+        else if (c >= 'a' && c <= 'f') {val = (val << 4) | (unsigned long)(c - 'a' + 10);}
+        else {return val;}
+    }
+}
+
+unsigned long scan_dec(char **pos){
+    //_|> descry: reads a decimal number and moves past it
+    //_|> pos: position in a line, moved past the digits
+    ///_|> returning: returns the value
+
+    unsigned long val = 0;
+    for (; **pos >= '0' && **pos <= '9'; (*pos)++) {
+        val = val * 10 + (unsigned long)(**pos - '0');
+    }
+    return val;
+}
+
+int scan_addr(char **pos, unsigned char *addr, unsigned short *port, int words){
+    //_|> descry: reads an address:port pair from /proc/net, the address is printed as 32 bit words in host order
+    //_|> pos: position in a line, moved past the pair
+    //_|> addr: filled with the address in network order
+    //_|> port: filled with the port
+    //_|> words: 1 for ipv4, 4 for ipv6
+    ///_|> returning: returns 1 on success, 0 if the line is cut short or not hex where the pair should be
+
+    for (int w = 0; w < words; w++) {
+
+        // 8 hex digits per word, no separator between words, stops at the end of a short line
+        uint32_t val = 0;
+        for (int d = 0; d < 8; d++, (*pos)++) {
+            if (!isxdigit((unsigned char)**pos)) {return 0;}
+            char c = **pos;
+            val = (val << 4) | (uint32_t)(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
+        memcpy(addr + w * 4, &val, 4);
+    }
+    if (**pos != ':' || !isxdigit((unsigned char)(*pos)[1])) {return 0;}
+    (*pos)++;
+    *port = (unsigned short)scan_hex(pos);
+    return 1;
+}
+
+void net_parse_inet(netinfo* net, char *line, int proto){
+    //_|> descry: parses one tcp or udp line, sl local rem st tx:rx tr:tm retrnsmt uid timeout inode
+    //_|> net: netinfo to add to
+    //_|> line: null terminated line
+    //_|> proto: PROTO_ value of the file
+    ///_|> returning: returns nothing
+
+    sockinfo sock;
+    memset(&sock, 0, sizeof(sock));
+    sock.proto = (unsigned char)proto;
+    int words = (proto == PROTO_TCP6 || proto == PROTO_UDP6) ? 4 : 1;
+
+    char *pos = skip_fields(line, 1);
+    if (*pos == '\0') {return;}
+    if (!scan_addr(&pos, sock.local, &sock.local_port, words)) {return;}
+    pos = skip_fields(pos, 0);
+    if (!scan_addr(&pos, sock.remote, &sock.remote_port, words)) {return;}
+    pos = skip_fields(pos, 0);
+    sock.state = (unsigned char)scan_hex(&pos);
+    pos = skip_fields(pos, 5);
+    sock.inode = scan_dec(&pos);
+    net_add(net, &sock);
+}
+
+void net_parse_unix(netinfo* net, char *line){
+    //_|> descry: parses one unix line, num refcount protocol flags type st inode path
+    //_|> net: netinfo to add to
+    //_|> line: null terminated line, the path stays in the buffer
+    ///_|> returning: returns nothing
+
+    sockinfo sock;
+    memset(&sock, 0, sizeof(sock));
+    sock.proto = PROTO_UNIX;
+    char *pos = skip_fields(line, 4);
+    if (*pos == '\0') {return;}
+    sock.unix_type = (unsigned short)scan_hex(&pos);
+    pos = skip_fields(pos, 0);
+    sock.state = (unsigned char)scan_hex(&pos);
+    pos = skip_fields(pos, 0);
+    sock.inode = scan_dec(&pos);
+    pos = skip_fields(pos, 0);
+    sock.path = *pos != '\0' ? pos - net->unix_buf : -1;
+    net_add(net, &sock);
+}
+
+void net_add(netinfo* net, sockinfo* sock){
+    //_|> descry: adds a socket to the array and its inode to the hash slots
+    //_|> net: netinfo to add to
+    //_|> sock: parsed socket
+    ///_|> returning: returns nothing
+
+    if (sock->inode == 0) {return;}
+    if (net->nsocks == net->cap) {
+        net->cap = net->cap == 0 ? COUNT_START : net->cap * 2;
+        sockinfo *grown = (sockinfo *)realloc(net->socks, net->cap * sizeof(sockinfo));
+        if (grown == NULL) {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        net->socks = grown;
+    }
+    net->socks[net->nsocks++] = *sock;
+
+    // rehash into double the slots when over half full
+    if (net->nsocks * 2 > net->nslots) {
+        free(net->slots);
+        net->nslots = net->nslots == 0 ? COUNT_START * 2 : net->nslots * 2;
+        net->slots = (int *)calloc(net->nslots, sizeof(int));
+        if (net->slots == NULL) {
+            fprintf(stderr, "Insufficient memory");
+            exit(1);
+        }
+        for (int i = 0; i < net->nsocks; i++) {
+            net_slot_set(net, i);
+        }
+    } else {
+        net_slot_set(net, net->nsocks - 1);
+    }
+}
+
+void net_slot_set(netinfo* net, int i){
+    //_|> descry: puts socket i in the first free slot for its inode, an inode already present keeps its first entry
+    //_|> net: netinfo
+    //_|> i: socket index
+    ///_|> returning: returns nothing
+
+    unsigned int mask = (unsigned int)net->nslots - 1;
+    unsigned int slot = (unsigned int)(net->socks[i].inode * 2654435761u) & mask;
+    while (net->slots[slot] != 0) {
+        if (net->socks[net->slots[slot] - 1].inode == net->socks[i].inode) {return;}
+        slot = (slot + 1) & mask;
+    }
+    net->slots[slot] = i + 1;
+}
+
+sockinfo *net_find(netinfo* net, long inode){
+    //_|> descry: looks up a socket by inode
+    //_|> net: netinfo, NULL if not loaded
+    //_|> inode: socket inode
+    ///_|> returning: returns the socket, NULL if not in this network namespace's tables
+
+    if (net == NULL || net->nslots == 0 || inode <= 0) {return NULL;}
+    unsigned int mask = (unsigned int)net->nslots - 1;
+    unsigned int slot = (unsigned int)((unsigned long)inode * 2654435761u) & mask;
+    while (net->slots[slot] != 0) {
+        sockinfo *sock = &net->socks[net->slots[slot] - 1];
+        if (sock->inode == (unsigned long)inode) {return sock;}
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+const char *sock_desc(netinfo* net, const char *file_name, long inode, char *desc, size_t size){
+    //_|> descry: describes a socket row as protocol, local -> remote address and state
+    //_|> net: netinfo, NULL when --sockets is off
+    //_|> file_name: filename of the row
+    //_|> inode: inode of the row
+    //_|> desc: buffer for the description
+    //_|> size: size of desc
+    ///_|> returning: returns desc, or an empty string for rows that are not known sockets
+
+    static const char *protos[] = {"tcp", "tcp6", "udp", "udp6", "unix"};
+    static const char *tcp_states[] = {"", "ESTABLISHED", "SYN_SENT", "SYN_RECV", "FIN_WAIT1", "FIN_WAIT2", "TIME_WAIT", "CLOSE", "CLOSE_WAIT", "LAST_ACK", "LISTEN", "CLOSING", "NEW_SYN_RECV"};
+    if (net == NULL || strncmp(file_name, "socket:[", 8) != 0) {return "";}
+    sockinfo *sock = net_find(net, inode);
+    if (sock == NULL) {return "";}
+
+    if (sock->proto == PROTO_UNIX) {
+        const char *type = sock->unix_type == 1 ? "STREAM" : sock->unix_type == 2 ? "DGRAM" : sock->unix_type == 5 ? "SEQPACKET" : "?";
+        const char *state = sock->state == 3 ? "CONNECTED" : sock->state == 1 ? "UNCONNECTED" : "";
+        snprintf(desc, size, "     unix %s %s %s", type, sock->path >= 0 ? net->unix_buf + sock->path : "-", state);
+        return desc;
+    }
+
+    char local[INET6_ADDRSTRLEN], remote[INET6_ADDRSTRLEN];
+    int family = (sock->proto == PROTO_TCP6 || sock->proto == PROTO_UDP6) ? AF_INET6 : AF_INET;
+    inet_ntop(family, sock->local, local, sizeof(local));
+    inet_ntop(family, sock->remote, remote, sizeof(remote));
+    const char *state = "";
+    if (sock->proto == PROTO_TCP || sock->proto == PROTO_TCP6) {
+        state = sock->state < sizeof(tcp_states) / sizeof(tcp_states[0]) ? tcp_states[sock->state] : "?";
+    } else {
+        state = sock->state == 1 ? "ESTABLISHED" : "UNCONN";
+    }
+    snprintf(desc, size, "     %s %s:%u -> %s:%u %s", protos[sock->proto], local, sock->local_port, remote, sock->remote_port, state);
+    return desc;
+}
+
+void net_free(netinfo* net){
+    //_|> descry: frees the socket table and its buffers
+    //_|> net: netinfo to free
+    ///_|> returning: returns nothing
+
+    free(net->socks);
+    free(net->slots);
+    free(net->buf);
+    free(net->unix_buf);
+    memset(net, 0, sizeof(netinfo));
+}
+
+#ifdef FD_STATS
+uint64_t stats_now(void){
+    //_|> descry: reads the monotonic clock for --stats timers
+    ///_|> returning: returns nanoseconds since an arbitrary start
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void stats_add(scanstats* total, scanstats* part){
+    //_|> descry: adds one thread's --stats timers and counters to a total
+    //_|> total: scanstats to add to
+    //_|> part: scanstats of one thread
+    ///_|> returning: returns nothing
+
+    for (int phase = 0; phase < STATS_PHASES; phase++) {
+        total->ns[phase] += part->ns[phase];
+        total->calls[phase] += part->calls[phase];
+    }
+    total->pids += part->pids;
+    total->denied += part->denied;
+    total->vanished += part->vanished;
+    total->fds += part->fds;
+    total->cache_hits += part->cache_hits;
+    total->writes += part->writes;
+}
+
+void print_stats(uint64_t wall){
+    //_|> descry: prints the --stats breakdown to stderr, so it never mixes into table or csv/json output
+    //_|> wall: nanoseconds since the arguments were parsed
+    ///_|> returning: returns nothing
+
+    static const char *names[STATS_PHASES] = {"list pids", "pid filter", "open fd dir", "getdents64", "stat", "readlink", "create_node", "merge", "summary", "output"};
+
+    // worker threads have already added theirs
+    stats_add(&stats_total, &stats);
+    scanstats *total = &stats_total;
+
+    fflush(stdout);
+    fprintf(stderr, "\n         --stats: %.3f ms wall (phases of --jobs workers are summed)\n", wall / 1e6);
+    fprintf(stderr, "         %-12s %10s %12s %10s\n", "phase", "calls", "ms", "us/call");
+    for (int phase = 0; phase < STATS_PHASES; phase++) {
+        if (total->calls[phase] == 0) {continue;}
+        fprintf(stderr, "         %-12s %10ld %12.3f %10.3f\n", names[phase], total->calls[phase], total->ns[phase] / 1e6, total->ns[phase] / 1e3 / total->calls[phase]);
+    }
+    fprintf(stderr, "         pids scanned %ld, skipped (permission) %ld, vanished %ld\n", total->pids, total->denied, total->vanished);
+    fprintf(stderr, "         fds %ld, inode cache hits %ld, output writes %ld\n", total->fds, total->cache_hits, total->writes);
+}
+#endif